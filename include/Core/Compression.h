@@ -0,0 +1,99 @@
+//===- Compression.h --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file Compression.h
+/// \author Federico Iannucci
+/// \brief This file contains the zlib compression of the outputs
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_CORE_COMPRESSION_H_
+#define INCLUDE_CORE_COMPRESSION_H_
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace chimera {
+namespace compression {
+
+/// @brief Compress data in a zlib stream
+/// @return If the compression succeeded
+bool compress(::llvm::StringRef data, ::std::string &compressed);
+
+/// @brief Uncompress a zlib stream
+/// @param size The size of the uncompressed data
+/// @return If the stream is valid and of the given size
+bool uncompress(::llvm::StringRef compressed, ::std::size_t size,
+                ::std::string &data);
+
+/// @brief Output stream on a gzip file
+class GzipOStream : public ::std::ostream {
+ public:
+  /// @brief Ctor, it opens the file
+  explicit GzipOStream(const ::std::string &path);
+  /// @brief Dtor, it closes the file
+  ~GzipOStream();
+
+  bool is_open() const { return this->buffer.isOpen(); }
+  /// @brief Flush and close the file
+  void close();
+
+ private:
+  /// @brief Buffer that writes on the gzip file
+  class Buffer : public ::std::streambuf {
+   public:
+    explicit Buffer(const ::std::string &path);
+    ~Buffer();
+
+    bool isOpen() const { return this->file != nullptr; }
+    /// @return If all the data is written
+    bool close();
+
+   protected:
+    virtual int_type overflow(int_type c) override;
+    virtual int sync() override;
+
+   private:
+    /// @brief Write the buffered data
+    bool flush_();
+
+    void *file;                 ///< The gzip file, a gzFile
+    ::std::vector<char> data;   ///< Buffered data
+  };
+
+  Buffer buffer;
+};
+
+/// @brief Write data as a gzip file
+/// @return If the file is written
+bool writeGzipFile(const ::std::string &path, ::llvm::StringRef data);
+
+/// @brief Read a gzip file
+/// @return If the file is read
+bool readGzipFile(const ::std::string &path, ::std::string &data);
+
+}  // End chimera::compression namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_CORE_COMPRESSION_H_ */
@@ -0,0 +1,128 @@
+//===- MetadataStore.h ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MetadataStore.h
+/// \author Federico Iannucci
+/// \brief This file contains the store of the metadata of the mutants
+/// \details The store of a run is an archive, see MutantStorage.h, with a
+///          record per mutant of each target, numbered from 1 in target and
+///          id order. A record is the target path, the mutant id as 8 bytes,
+///          the number of entries, then for each entry its fields in
+///          declaration order: the strings as their 4 bytes size and their
+///          bytes, line as 4 bytes and trip count as 8 bytes, little endian.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_CORE_METADATASTORE_H_
+#define INCLUDE_CORE_METADATASTORE_H_
+
+#include "Core/Mutant.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace chimera {
+namespace mutant {
+
+/// @brief Metadata of an operation mutated by an operator, the fields that
+/// don't apply are left empty
+struct MetadataEntry {
+  ::std::string mutator;         ///< Mutator identifier
+  ::std::string operationId;     ///< Operation identifier
+  unsigned line;                 ///< Occurrence line
+  ::std::string returnType;      ///< Operation return type
+  ::std::string operation;       ///< Operation code
+  ::std::string operand1;        ///< Operand 1, or the operation producing it
+  ::std::string operand2;        ///< Operand 2, or the operation producing it
+  ::std::string returnVariable;  ///< Variable the result is assigned to
+  ::std::string increment;       ///< Loop increment
+  ::std::int64_t tripCount;      ///< Loop length, -1 if unknown
+
+  MetadataEntry() : line(0), tripCount(-1) {}
+};
+
+/// @brief Metadata of the mutants of a target, filled by the mutators and
+/// added to the store of the run at the end of the analysis
+class MetadataStore {
+ public:
+  /// @brief Add an entry to the metadata of a mutant
+  void add(IdType id, MetadataEntry entry);
+
+  bool empty() const { return this->entries.empty(); }
+
+  const ::std::map<IdType, ::std::vector<MetadataEntry>> &getEntries() const {
+    return this->entries;
+  }
+
+ private:
+  ::std::map<IdType, ::std::vector<MetadataEntry>> entries;  ///< Per mutant
+};
+
+/// @brief Store of the metadata of the mutants of all the targets of a run,
+/// keyed by target and mutant id, written in a single file at the end of
+/// the run
+class RunMetadataStore {
+ public:
+  /// @brief Add the metadata of the mutants of a target. Thread safe.
+  /// @param target The target path
+  /// @return If no mutant of the target was already in the store, the
+  ///         metadata already stored are kept
+  bool add(const ::std::string &target, const MetadataStore &store);
+
+  /// @brief Read a store, adding its mutants
+  /// @return If the store is readable and none of its mutants was already in
+  ///         this one
+  bool read(const ::std::string &path);
+
+  /// @brief Write the store
+  /// @return If the store is written
+  bool write(const ::std::string &path) const;
+
+  /// @brief Get the metadata of a mutant
+  /// @return If the mutant is in the store
+  bool get(const ::std::string &target, IdType id,
+           ::std::vector<MetadataEntry> &entries) const;
+
+  /// @brief Parse the record of a mutant
+  /// @return If the record is well formed
+  static bool parse(::llvm::StringRef record, ::std::string &target,
+                    IdType &id, ::std::vector<MetadataEntry> &entries);
+
+  bool empty() const;
+
+  static const char *const storeFileName;  ///< Name of the store file
+
+ private:
+  /// @brief Key of a mutant: target path and id
+  using Key = ::std::pair<::std::string, IdType>;
+
+  mutable ::std::mutex mutex;  ///< It guards the entries
+  ::std::map<Key, ::std::vector<MetadataEntry>> entries;  ///< Per mutant
+};
+
+}  // End chimera::mutant namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_CORE_METADATASTORE_H_ */
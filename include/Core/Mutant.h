@@ -26,10 +26,12 @@
 #ifndef INCLUDE_MUTANT_H_
 #define INCLUDE_MUTANT_H_
 
+#include <cstdint>
+
 namespace chimera {
 namespace mutant {
 
-using IdType = unsigned int;
+using IdType = ::std::uint64_t;
 
 /**
  * @brief Generic Mutant Class
@@ -0,0 +1,100 @@
+//===- MutantIds.h ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantIds.h
+/// \author Federico Iannucci
+/// \brief This file contains the location-derived mutant ids
+/// \details A mutation is identified by the 64 bits key of its target file
+///          name, function, spelling line and column, mutator identifier and
+///          type. Its id is the key itself, so it doesn't depend on the
+///          other mutations, nor on the shard or the unit generating it.
+///          Only the same location mutated twice finds its id taken, and it
+///          is probed linearly: the two mutations always fall in the same
+///          shard and unit, so they are probed in the same order.
+///          The map is written as ids.csv, sorted by key, with the dense
+///          index of each mutant: the same mutants get the same rows in any
+///          run, however their ids have been assigned.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_CORE_MUTANTIDS_H_
+#define INCLUDE_CORE_MUTANTIDS_H_
+
+#include "Core/Mutant.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace chimera {
+namespace mutant {
+
+/// @brief How the mutant ids are assigned
+enum IdScheme {
+  SequentialIds, ///< In order of commit, starting from 1
+  LocationIds    ///< Derived from the location of the mutation
+};
+
+/// @brief Compute the key of a mutation
+::std::uint64_t computeLocationKey(::llvm::StringRef file,
+                                   ::llvm::StringRef function, unsigned line,
+                                   unsigned column, ::llvm::StringRef mutator,
+                                   unsigned type);
+
+/// @brief Ids of the mutants of a target, derived from their location
+class LocationIdMap {
+ public:
+  /// @brief Assign the id of a mutation
+  /// @param collided Set if the key was already taken
+  /// @return The id, never 0
+  IdType assign(::llvm::StringRef file, ::llvm::StringRef function,
+                unsigned line, unsigned column, ::llvm::StringRef mutator,
+                unsigned type, bool &collided);
+
+  /// @brief Write the map, sorted by key
+  /// @return If the map is written
+  bool write(const ::std::string &path) const;
+
+  ::std::size_t size() const { return this->entries.size(); }
+
+  static const char *const mapFileName;  ///< Name of the map file
+
+ private:
+  /// @brief An assigned id
+  struct Entry {
+    ::std::uint64_t key;
+    IdType id;
+    ::std::string function;
+    unsigned line;
+    unsigned column;
+    ::std::string mutator;
+    unsigned type;
+  };
+
+  ::std::map<IdType, ::std::size_t> taken;  ///< Index of the entry of an id
+  ::std::vector<Entry> entries;             ///< In order of assignment
+};
+
+}  // End chimera::mutant namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_CORE_MUTANTIDS_H_ */
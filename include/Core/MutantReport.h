@@ -0,0 +1,89 @@
+//===- MutantReport.h -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantReport.h
+/// \author Federico Iannucci
+/// \brief This file contains the binary columnar report of the mutants
+/// \details The binary report, little endian, is made of:
+///          - the header: magic "CHMRRPT", version, number of rows, of
+///            function names and of mutator identifiers, 8 bytes each;
+///          - the string tables, function names then mutator identifiers,
+///            each string as its 4 bytes size and its bytes;
+///          - padding to a multiple of 8 bytes;
+///          - the columns: mutant id, 8 bytes per row, then function name
+///            index, line, column, mutator identifier index and mutator
+///            type, 4 bytes per row each.
+///          The rows are in the order of report.csv.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_CORE_MUTANTREPORT_H_
+#define INCLUDE_CORE_MUTANTREPORT_H_
+
+#include "Core/Mutant.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace chimera {
+namespace mutant {
+
+/// @brief Writer of the binary columnar report
+/// @details The rows are kept in memory, column by column, and written at
+///          the end.
+class BinaryReportWriter {
+ public:
+  /// @brief Add a row
+  void addEntry(IdType id, const ::std::string &functionName, unsigned line,
+                unsigned column, const ::std::string &mutatorIdentifier,
+                unsigned type);
+
+  /// @brief Write the report
+  /// @return If the report is written
+  bool write(const ::std::string &path) const;
+
+  ::std::size_t size() const { return this->ids.size(); }
+
+  static const char *const reportFileName;  ///< Name of the report file
+
+ private:
+  /// @brief Strings of a column, each one with its index
+  struct StringTable {
+    ::std::map<::std::string, ::std::uint32_t> indexes;
+    ::std::vector<const ::std::string *> strings;  ///< By index
+
+    ::std::uint32_t getIndex(const ::std::string &s);
+  };
+
+  StringTable functions;                  ///< Function names
+  StringTable mutators;                   ///< Mutator identifiers
+  ::std::vector<IdType> ids;              ///< Mutant ids
+  ::std::vector<::std::uint32_t> functionIndexes;
+  ::std::vector<::std::uint32_t> lines;
+  ::std::vector<::std::uint32_t> columns;
+  ::std::vector<::std::uint32_t> mutatorIndexes;
+  ::std::vector<::std::uint32_t> types;   ///< Mutator types
+};
+
+}  // End chimera::mutant namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_CORE_MUTANTREPORT_H_ */
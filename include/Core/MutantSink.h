@@ -0,0 +1,132 @@
+//===- MutantSink.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantSink.h
+/// \author Federico Iannucci
+/// \brief This file contains the consumers of the validated mutants
+/// \details The stream sink writes a record per mutant, little endian: the
+///          record size (8 bytes), target path (4 bytes size and bytes), id
+///          (8 bytes), line, column, mutator type (4 bytes each), function
+///          name and mutator identifier (4 bytes size and bytes each), the
+///          number of edits (4 bytes), for each edit its offset, length (8
+///          bytes each) and replacement (4 bytes size and bytes), then the
+///          mutant code (8 bytes size and bytes). The records of all the
+///          targets share the stream, which ends with a record of size 0.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_CORE_MUTANTSINK_H_
+#define INCLUDE_CORE_MUTANTSINK_H_
+
+#include "Core/Mutant.h"
+#include "Core/MutantStorage.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace chimera {
+namespace mutant {
+
+/// @brief Description of a validated mutant
+struct MutantInfo {
+  ::llvm::StringRef target;         ///< Target path
+  IdType id;                        ///< Mutant unique id
+  ::llvm::StringRef functionName;   ///< Function of the mutation
+  unsigned line;                    ///< Line of the mutation
+  unsigned column;                  ///< Column of the mutation
+  ::llvm::StringRef mutator;        ///< Mutator identifier
+  unsigned type;                    ///< Mutator type
+};
+
+/// @brief Consumer of the mutants, called as soon as each one is validated
+class MutantSink {
+ public:
+  virtual ~MutantSink() {}
+
+  /// @brief Consume a mutant
+  /// @param info The mutant description
+  /// @param edits The edits on the original, if wanted
+  /// @param code The mutant code
+  /// @return If the mutant is consumed
+  virtual bool consume(const MutantInfo &info, const EditList &edits,
+                       ::llvm::StringRef code) = 0;
+
+  /// @brief If consume needs the edits, they cost a comparison of the mutant
+  /// with the original
+  virtual bool wantsEdits() const { return false; }
+};
+
+/// @brief Sink that stores the mutants, the default
+class StorageMutantSink : public MutantSink {
+ public:
+  explicit StorageMutantSink(MutantStorage *storage) : storage(storage) {}
+
+  virtual bool consume(const MutantInfo &info, const EditList &edits,
+                       ::llvm::StringRef code) override {
+    return this->storage->store(info.id, code);
+  }
+
+ private:
+  MutantStorage *storage;  ///< The storage, not owned
+};
+
+/// @brief Sink that streams length-prefixed records on a file descriptor
+/// @details A single sink serves all the targets of a run: the records are
+///          written whole, one at a time, also when the targets are processed
+///          concurrently.
+class StreamMutantSink : public MutantSink {
+ public:
+  /// @brief Ctor
+  /// @param fd The descriptor, closed by the sink
+  explicit StreamMutantSink(int fd) : fd(fd) {}
+  /// @brief Dtor, it ends the stream
+  virtual ~StreamMutantSink();
+
+  StreamMutantSink(const StreamMutantSink &) = delete;
+  StreamMutantSink &operator=(const StreamMutantSink &) = delete;
+
+  /// @brief Stream on the standard output, moving the rest of the output,
+  /// as the log, to the standard error
+  /// @return The sink, nullptr if it isn't possible
+  static ::std::unique_ptr<StreamMutantSink> openStdout();
+  /// @brief Stream on a local socket, listened by the consumer
+  /// @return The sink, nullptr if the connection fails
+  static ::std::unique_ptr<StreamMutantSink>
+  openSocket(const ::std::string &socketPath);
+
+  virtual bool consume(const MutantInfo &info, const EditList &edits,
+                       ::llvm::StringRef code) override;
+  virtual bool wantsEdits() const override { return true; }
+
+ private:
+  /// @brief Write all the data, the stream is dropped at the first error.
+  /// The mutex must be held.
+  bool write_(::llvm::StringRef data);
+
+  ::std::mutex mutex;  ///< It serializes the records
+  int fd;              ///< The descriptor, -1 if dropped
+};
+
+}  // End chimera::mutant namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_CORE_MUTANTSINK_H_ */
@@ -0,0 +1,308 @@
+//===- MutantStorage.h ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantStorage.h
+/// \author Federico Iannucci
+/// \brief This file contains the storages of the generated mutants
+/// \details The patch storage writes in <target output dir>:
+///          - original/<file>, the target as parsed,
+///          - mutants.patch, the edits of each mutant on the original.
+///          The patch file starts with the line "chimera-patch 1", then for
+///          each mutant a line "@<id> <edits>" followed, for each edit, by a
+///          line "<offset> <length> <size>" and the <size> bytes of the
+///          replacement plus a newline.
+///          The archive storage writes <target output dir>/mutants.archive,
+///          little endian: a header (magic "CHMRARC", or "CHMRARZ" if
+///          compressed, version), the records (id, size, then the mutant
+///          code, or its size and its zlib stream) and, once the storage is
+///          closed, the magic "CHMRIDX", the index (id, code offset, size
+///          per mutant, sorted by id) and the trailer (index offset,
+///          entries, magic "CHMRIDX").
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_CORE_MUTANTSTORAGE_H_
+#define INCLUDE_CORE_MUTANTSTORAGE_H_
+
+#include "Core/Mutant.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace chimera {
+namespace mutant {
+
+/// @brief Replacement of [offset, offset + length) of the original
+struct Edit {
+  ::std::size_t offset;
+  ::std::size_t length;
+  ::std::string replacement;
+};
+using EditList = ::std::vector<Edit>;
+
+/// @brief Compute the edits that turn the original into the code
+EditList computeEdits(::llvm::StringRef original, ::llvm::StringRef code);
+
+/// @brief Apply sorted and disjoint edits to the original
+::std::string applyEdits(::llvm::StringRef original, const EditList &edits);
+
+/// @brief How the mutants are stored
+enum StorageFormat {
+  FilesStorage, ///< A full copy of the target per mutant
+  PatchStorage, ///< The original once, then the edits of each mutant
+  ArchiveStorage ///< All the mutants in a single indexed file
+};
+
+/// @brief Abstract storage of the mutants of a target
+class MutantStorage {
+ public:
+  /// @brief Ctor
+  /// @param outputDirectory The target output directory, with the trailing
+  ///        path separator
+  /// @param filename The target file name
+  MutantStorage(::std::string outputDirectory, ::std::string filename)
+      : outputDirectory(::std::move(outputDirectory)),
+        filename(::std::move(filename)) {}
+  virtual ~MutantStorage() {}
+
+  /// @brief Store a mutant
+  /// @param id Mutant unique id
+  /// @param code The mutant
+  /// @return If the mutant is correctly stored
+  virtual bool store(IdType id, ::llvm::StringRef code) = 0;
+
+  /// @brief Return the directory of a mutant, with the trailing path
+  /// separator, where also the mutators save their artifacts
+  ::std::string getMutantDirectory(IdType id) const;
+
+ protected:
+  ::std::string outputDirectory; ///< Target output directory
+  ::std::string filename;        ///< Target file name
+};
+
+/// @brief Storage of a full copy per mutant, in <id>/<file>, or
+/// <id>/<file>.gz if compressed
+class FileMutantStorage : public MutantStorage {
+ public:
+  /// @brief Ctor
+  /// @param compress If the copies are gzip files
+  FileMutantStorage(::std::string outputDirectory, ::std::string filename,
+                    bool compress = false)
+      : MutantStorage(::std::move(outputDirectory), ::std::move(filename)),
+        compress(compress), originalFD(-1), copyFileRange(true) {}
+  virtual ~FileMutantStorage();
+
+  virtual bool store(IdType id, ::llvm::StringRef code) override;
+
+  /// @brief Write each mutant as the slices of the original around its
+  /// edits: a single gathered write, or, for the long untouched spans, an
+  /// in-kernel copy from the target file. Only for the uncompressed copies.
+  /// @param original The target code
+  /// @param originalPath The target file, with the same content
+  void setOriginal(::std::string original, const ::std::string &originalPath);
+
+ private:
+  /// @brief Write the original with the edits
+  /// @return If the file is written
+  bool writeSlices_(const ::std::string &filePath, const EditList &edits);
+
+  bool compress;          ///< If the copies are compressed
+  ::std::string original; ///< The target code, if set
+  int originalFD;         ///< The target file, -1 if not open
+  bool copyFileRange;     ///< If the in-kernel copy is supported
+};
+
+/// @brief Storage of the edits of each mutant on the original
+class PatchMutantStorage : public MutantStorage {
+ public:
+  /// @brief Ctor, it writes the original
+  /// @param original The target code, as parsed
+  PatchMutantStorage(::std::string outputDirectory, ::std::string filename,
+                     ::std::string original);
+
+  virtual bool store(IdType id, ::llvm::StringRef code) override;
+
+  static const char *const patchFileName;    ///< Name of the patch file
+  static const char *const originalDirName;  ///< Directory of the original
+
+ private:
+  ::std::string original;       ///< The target code
+  ::std::ofstream patchStream;  ///< The patch file
+};
+
+/// @brief Reader of the mutants of a patch storage
+class PatchMutantReader {
+ public:
+  /// @brief Open the patch storage of a target, indexing its mutants
+  /// @param outputDirectory The target output directory, with the trailing
+  ///        path separator
+  /// @param filename The target file name
+  /// @return If the storage is readable
+  bool open(const ::std::string &outputDirectory,
+            const ::std::string &filename);
+
+  /// @brief Reconstruct a mutant
+  /// @param id Mutant unique id
+  /// @param code Set to the mutant code
+  /// @return If the mutant exists
+  bool read(IdType id, ::std::string &code);
+
+  /// @brief Read the edits of a mutant
+  bool readEdits(IdType id, EditList &edits);
+
+  /// @return The ids of the stored mutants, in ascending order
+  ::std::vector<IdType> getIds() const;
+
+  const ::std::string &getOriginal() const { return this->original; }
+
+ private:
+  ::std::string original;                     ///< The target code
+  ::std::ifstream patchStream;                ///< The patch file
+  ::std::map<IdType, ::std::streamoff> index; ///< Position of each mutant
+};
+
+/// @brief Index entry of an archived mutant
+struct ArchiveEntry {
+  IdType id;
+  ::std::uint64_t offset;  ///< Offset of the code in the archive
+  ::std::uint64_t size;    ///< Size of the code
+};
+
+/// @brief Writer of an append-only archive of records keyed by mutant id
+class ArchiveWriter {
+ public:
+  /// @brief Ctor, it writes the archive header
+  /// @param compress If each record is compressed, on its own
+  ArchiveWriter(const ::std::string &archivePath, bool compress = false);
+  /// @brief Dtor, it writes the index
+  ~ArchiveWriter();
+
+  ArchiveWriter(const ArchiveWriter &) = delete;
+  ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+
+  /// @brief Append a record
+  /// @return If the record is written
+  bool append(IdType id, ::llvm::StringRef data);
+
+  bool isOpen() const { return this->archive != nullptr; }
+
+ private:
+  ::std::unique_ptr<::llvm::raw_fd_ostream> archive;  ///< The archive file
+  ::std::vector<ArchiveEntry> index;                  ///< The records
+  bool compress;                                      ///< If compressed
+};
+
+/// @brief Storage of all the mutants in a single append-only archive
+class ArchiveMutantStorage : public MutantStorage {
+ public:
+  /// @brief Ctor, it writes the archive header
+  /// @param compress If each mutant is compressed, on its own
+  ArchiveMutantStorage(::std::string outputDirectory, ::std::string filename,
+                       bool compress = false);
+
+  virtual bool store(IdType id, ::llvm::StringRef code) override;
+
+  static const char *const archiveFileName;  ///< Name of the archive file
+
+ private:
+  ArchiveWriter archive;  ///< The archive
+};
+
+/// @brief Reader of the mutants of an archive
+/// @details The archive is mapped in memory, the stored mutants are read in
+///          place. If the archive has no index, because the generation
+///          didn't end, the records are scanned.
+class ArchiveMutantReader {
+ public:
+  ArchiveMutantReader() : compressed(false) {}
+
+  /// @brief Open an archive
+  /// @param archivePath Path of the archive file
+  /// @return If the archive is readable
+  bool open(const ::std::string &archivePath);
+
+  /// @brief Read a mutant, uncompressing it if needed
+  /// @param id Mutant unique id
+  /// @param code Set to the mutant code
+  /// @return If the mutant exists and is readable
+  bool read(IdType id, ::std::string &code) const;
+
+  /// @brief Find a stored mutant
+  /// @param id Mutant unique id
+  /// @param data Set to the stored data, valid while the reader is open. For
+  ///        a compressed archive, the size and the zlib stream.
+  /// @return If the mutant exists
+  bool readStored(IdType id, ::llvm::StringRef &data) const;
+
+  bool isCompressed() const { return this->compressed; }
+
+  /// @return The ids of the stored mutants, in ascending order
+  ::std::vector<IdType> getIds() const;
+
+  ::std::size_t size() const { return this->index.size(); }
+
+ private:
+  /// @brief Build the index from the records, for an archive without it
+  bool scan_();
+
+  ::std::unique_ptr<::llvm::MemoryBuffer> buffer;  ///< The mapped archive
+  ::std::vector<ArchiveEntry> index;               ///< Sorted by id
+  bool compressed;                                 ///< If compressed
+};
+
+/// @brief Reader of the mutants of a target, whatever the storage format
+class MutantExtractor {
+ public:
+  /// @brief Open the storage of a target, detecting its format
+  /// @param outputDirectory The target output directory, with the trailing
+  ///        path separator
+  /// @param filename The target file name
+  /// @return If a storage is found
+  bool open(const ::std::string &outputDirectory,
+            const ::std::string &filename);
+
+  /// @brief Read a mutant
+  /// @param id Mutant unique id
+  /// @param code Set to the mutant code
+  /// @return If the mutant exists and is readable
+  bool read(IdType id, ::std::string &code);
+
+  StorageFormat getFormat() const { return this->format; }
+
+ private:
+  StorageFormat format;            ///< Format of the opened storage
+  ::std::string outputDirectory;   ///< Target output directory
+  ::std::string filename;          ///< Target file name
+  PatchMutantReader patchReader;   ///< Reader of a patch storage
+  ArchiveMutantReader archiveReader;  ///< Reader of an archive storage
+};
+
+}  // End chimera::mutant namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_CORE_MUTANTSTORAGE_H_ */
@@ -31,15 +31,31 @@
 #include "Log.h"
 #include "Core/Mutant.h"
 #include "Core/MutationOperator.h"
+#include "Core/Compression.h"
+#include "Core/MetadataStore.h"
+#include "Core/MutantIds.h"
+#include "Core/MutantReport.h"
+#include "Core/MutantSink.h"
+#include "Core/MutantStorage.h"
+#include "Tooling/LexicalPrefilter.h"
+#include "Tooling/MutantBatch.h"
+#include "Tooling/OperatorValidator.h"
+#include "Tooling/OutputQueue.h"
+#include "Tooling/ValidationCache.h"
+#include "Tooling/ValidationPool.h"
+#include "Tooling/ValidationSession.h"
 
 #include "clang/Tooling/Tooling.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Path.h"
 
+#include <algorithm>
 #include <fstream>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -54,6 +70,34 @@ class MatchFinder;
 
 namespace chimera
 {
+/// @brief How the mutants are passed to the syntax check
+enum ValidationMode {
+    OnDiskValidation,  ///< Write the mutant in a temp file and check it
+    InMemoryValidation ///< Overlay the mutant on the target, without files
+};
+
+/// @brief Counters of the mutant checks of a template
+struct ValidationStatistics {
+    unsigned long checked; ///< Mutants passed to the syntax check
+    unsigned long syntaxSafe; ///< Mutants valid by construction, not checked
+    unsigned long astDecided; ///< Mutants decided on the AST, not checked
+    unsigned long duplicates; ///< Mutants equal to a previous one
+    /// Mutants rejected by the lexical prefilter, by verdict
+    unsigned long prefilterRejected[prefilter::NumVerdicts];
+
+    ValidationStatistics() {
+        this->reset();
+    }
+    void reset() {
+        this->checked = 0;
+        this->syntaxSafe = 0;
+        this->astDecided = 0;
+        this->duplicates = 0;
+        ::std::fill ( this->prefilterRejected,
+                      this->prefilterRejected + prefilter::NumVerdicts, 0 );
+    }
+};
+
 /// @brief This class represent the context of mutation for a single .h/.cpp
 /// file.
 class MutationTemplate
@@ -69,6 +113,7 @@ public:
     /// @param outputDirectory The directory for the outputs
     MutationTemplate ( const clang::tooling::CompileCommand &, std::string target,
                        std::string outputDirectory = "." );
+    ~MutationTemplate();
 
     // Getter and Setter
     const std::string &getTargetPath() const {
@@ -112,6 +157,38 @@ public:
         this->generateMutantsReport = val;
     }
 
+    bool isGenerateBinaryReport() const {
+        return this->generateBinaryReport;
+    }
+    /// @brief Write also the binary columnar report, report.bin
+    void setGenerateBinaryReport ( bool val ) {
+        this->generateBinaryReport = val;
+    }
+
+    /// @brief Return the binary report, nullptr if it isn't generated. It
+    /// exists only during the analysis, it is written at the end.
+    mutant::BinaryReportWriter *getBinaryReport() {
+        return this->binaryReport.get();
+    }
+
+    bool isUseMetadataStore() const {
+        return this->runMetadataStore != nullptr;
+    }
+    /// @brief Keep the metadata of the mutators in the store of the run,
+    /// instead of a report per mutant directory
+    /// @param store The store of the run, nullptr to disable it. It must
+    ///        outlive the analysis.
+    void setRunMetadataStore ( mutant::RunMetadataStore *store ) {
+        this->runMetadataStore = store;
+    }
+
+    /// @brief Return the metadata store of the target, nullptr if it isn't
+    /// used. It exists only during the analysis, it is added to the store
+    /// of the run at the end.
+    mutant::MetadataStore *getMetadataStore() {
+        return this->metadataStore.get();
+    }
+
     bool isGenerateMutants() {
         return this->generateMutants;
     }
@@ -119,6 +196,223 @@ public:
         this->generateMutants = val;
     }
 
+    mutant::StorageFormat getStorageFormat() const {
+        return this->storageFormat;
+    }
+    /// @brief Set how the generated mutants are stored
+    void setStorageFormat ( mutant::StorageFormat format ) {
+        this->storageFormat = format;
+    }
+
+    /// @brief Return the storage of the mutants, nullptr if they aren't
+    /// generated. It exists only during the analysis.
+    mutant::MutantStorage *getMutantStorage() {
+        return this->mutantStorage.get();
+    }
+
+    mutant::MutantSink *getMutantStream() const {
+        return this->mutantStream;
+    }
+    /// @brief Stream the mutants, as soon as they are validated, instead of
+    /// storing them
+    /// @param stream The sink shared by all the targets of the run, nullptr
+    ///        to store them. It must outlive the analysis.
+    void setMutantStream ( mutant::MutantSink *stream ) {
+        this->mutantStream = stream;
+    }
+
+    /// @brief Return the consumer of the mutants, nullptr if they aren't
+    /// generated: the stream, or the sink of the storage that exists only
+    /// during the analysis.
+    mutant::MutantSink *getMutantSink() {
+        return this->mutantSink ? this->mutantSink.get() : this->mutantStream;
+    }
+
+    /// @brief Return the target code, the reference of the edits passed to
+    /// the sink. Empty if the sink doesn't want them.
+    const ::std::string &getTargetCode() const {
+        return this->targetCode;
+    }
+
+    bool isCompressOutput() const {
+        return this->compressOutput;
+    }
+    /// @brief Compress the mutants and the report with zlib, each mutant on
+    /// its own. The patches aren't compressed.
+    void setCompressOutput ( bool val ) {
+        this->compressOutput = val;
+    }
+
+    unsigned getOutputQueueSize() const {
+        return this->outputQueueSize;
+    }
+    /// @brief Set how many writes of mutants and reports can wait for the
+    /// writer thread, 0 writes them on the matching thread
+    void setOutputQueueSize ( unsigned size ) {
+        this->outputQueueSize = size;
+    }
+
+    /// @brief Perform a write of the outputs, on the writer thread if it
+    /// exists. The writes are performed in order.
+    void writeOutput ( OutputQueue::Task task ) {
+        if ( this->outputQueue ) {
+            this->outputQueue->push ( std::move ( task ) );
+        } else {
+            task();
+        }
+    }
+
+    ValidationMode getValidationMode() const {
+        return this->validationMode;
+    }
+    void setValidationMode ( ValidationMode mode ) {
+        this->validationMode = mode;
+    }
+
+    bool isUsePreamble() const {
+        return this->usePreamble;
+    }
+    /// @brief Reuse a precompiled preamble of the target for the in-memory
+    /// validation
+    void setUsePreamble ( bool val ) {
+        this->usePreamble = val;
+    }
+
+    unsigned getValidationJobs() const {
+        return this->validationJobs;
+    }
+    /// @brief Set the number of threads that check the mutants, only the
+    /// in-memory validation runs in parallel
+    void setValidationJobs ( unsigned jobs ) {
+        this->validationJobs = jobs;
+    }
+
+    unsigned getValidationBatch() const {
+        return this->validationBatch;
+    }
+    /// @brief Set how many mutants of the same function bodies are checked
+    /// in a single parse, 1 disables the batches. Only for the in-memory
+    /// validation.
+    void setValidationBatch ( unsigned size ) {
+        this->validationBatch = size;
+    }
+
+    bool isUsePrefilter() const {
+        return this->usePrefilter;
+    }
+    /// @brief Reject the lexically broken mutants before the syntax check
+    void setUsePrefilter ( bool val ) {
+        this->usePrefilter = val;
+    }
+
+    bool isParanoid() const {
+        return this->paranoid;
+    }
+    /// @brief Check also the mutants that the mutators declare syntax safe
+    /// or that the AST validator decides
+    void setParanoid ( bool val ) {
+        this->paranoid = val;
+    }
+
+    bool isUseOperatorValidator() const {
+        return this->useOperatorValidator;
+    }
+    /// @brief Decide the operator replacements on the AST, without a reparse
+    void setUseOperatorValidator ( bool val ) {
+        this->useOperatorValidator = val;
+    }
+
+    bool isDeduplicate() const {
+        return this->deduplicate;
+    }
+    /// @brief Report the mutants equal to a previous one as its aliases,
+    /// without checking and saving them again
+    void setDeduplicate ( bool val ) {
+        this->deduplicate = val;
+    }
+
+    /// @brief Return the id of the first occurrence of each mutant code, 0 if
+    /// it is invalid, keyed by the hash of the code
+    ::std::unordered_map<ValidationCache::KeyType, mutant::IdType> &
+    getFirstOccurrences() {
+        return this->firstOccurrences;
+    }
+
+    mutant::IdScheme getIdScheme() const {
+        return this->idScheme;
+    }
+    /// @brief Set how the ids of the reports and of the outputs are assigned
+    void setIdScheme ( mutant::IdScheme scheme ) {
+        this->idScheme = scheme;
+    }
+
+    /// @brief Return the id of a mutant, the first time assigning it
+    /// according to the id scheme. A HOM mutant takes the location of its
+    /// first committed mutation.
+    /// @param internalId The id that keeps the rewriter of the mutant
+    mutant::IdType getMutantId ( mutant::IdType internalId,
+                                 const ::std::string &functionName,
+                                 unsigned line, unsigned column,
+                                 const ::std::string &mutatorIdentifier,
+                                 unsigned type );
+    /// @brief Return the id assigned to a mutant, the internal one if it
+    /// hasn't been assigned
+    mutant::IdType getMutantId ( mutant::IdType internalId ) const;
+
+    unsigned getShardIndex() const {
+        return this->shardIndex;
+    }
+    unsigned getShardCount() const {
+        return this->shardCount;
+    }
+    /// @brief Restrict the run to a shard: each first order mutation, and
+    /// each HOM mutant, belongs to one of the shards by the key of its
+    /// location, so the shards need the location ids to be merged
+    /// @param index The shard, in [0, count)
+    /// @param count The number of shards, 1 for the whole run
+    void setShard ( unsigned index, unsigned count ) {
+        this->shardIndex = index;
+        this->shardCount = count;
+    }
+    /// @brief If a first order mutation belongs to the shard of the run
+    bool isInShard ( const ::std::string &functionName, unsigned line,
+                     unsigned column, const ::std::string &mutatorIdentifier,
+                     unsigned type ) const;
+    /// @brief If a HOM mutant belongs to the shard of the run
+    /// @param identifier The identifier of its operator, or of its mutator
+    bool isInShard ( const ::std::string &identifier ) const;
+
+    ValidationStatistics &getValidationStatistics() {
+        return this->validationStatistics;
+    }
+
+    ValidationCache *getValidationCache() const {
+        return this->validationCache;
+    }
+    /// @brief Set the verdicts cache, shared among templates, nullptr to
+    /// disable it
+    void setValidationCache ( ValidationCache *cache ) {
+        this->validationCache = cache;
+    }
+
+    /// @brief Return the validation session of the target, it is built at
+    /// the first call and reused for all the checks of this template
+    ValidationSession &getValidationSession();
+
+    /// @brief Return the validation pool, nullptr if the mutants are checked
+    /// serially. It exists only during the analysis.
+    ValidationPool *getValidationPool() {
+        return this->validationPool.get();
+    }
+
+    /// @brief Return the batch of mutants being filled, nullptr if the
+    /// batches are disabled. It exists only during the analysis.
+    MutantBatch *getOpenBatch() {
+        return this->openBatch.get();
+    }
+    /// @brief Pass the open batch to the validation pool and open a new one
+    void closeBatch();
+
     /// @defgroup
     /// @brief Functions to manage the mutation template's report stream
     /// @{
@@ -162,6 +456,14 @@ public:
     ///        It starts from 1. Mutant #0 is reserved.
     mutant::IdType mutantCounter;
 
+    /// @brief The rewriters, the reserved ids and the deferred HOM mutants of
+    /// the analysis. They belong to the template, so that the templates of
+    /// different targets can run concurrently.
+    struct MutantSlots;
+    MutantSlots &getMutantSlots() {
+        return *this->mutantSlots;
+    }
+
 private:
     void initMutantIds_();
     void addMatchers_ ( ::clang::ast_matchers::MatchFinder &,
@@ -170,7 +472,11 @@ private:
                         const ::std::vector<m_operator::IdType> &,
                         const ::std::string & );
     int run ( clang::ast_matchers::MatchFinder & );
+    void createMutantStorage_();
+    void createMutantSink_();
+    ::std::unique_ptr<ValidationSession> createValidationSession_() const;
 
+    ::std::unique_ptr<MutantSlots> mutantSlots; ///< State of the mutant ids
     ::clang::tooling::CompileCommand
     compileCommand;               ///< Compile command for this target.
     ::clang::tooling::ClangTool tool; /**< Inner ClangTool to do the analysis */
@@ -185,10 +491,55 @@ private:
 
     bool generateMutantsReport; ///< If mutants report has to be save
     bool generateMutants;       ///< If mutants have to be saved.
+    mutant::StorageFormat storageFormat; ///< How the mutants are stored
+    ::std::unique_ptr<mutant::MutantStorage>
+    mutantStorage;                 ///< Storage of the mutants, if generated
+    mutant::MutantSink *mutantStream; ///< Stream of the run, if used
+    ::std::unique_ptr<mutant::MutantSink>
+    mutantSink;                    ///< Consumer of the mutants, if generated
+    ::std::string targetCode;      ///< Target code, if the sink wants edits
+    bool compressOutput;           ///< If the outputs are compressed
+    unsigned outputQueueSize;      ///< Bound on the queued writes
+    ::std::unique_ptr<OutputQueue>
+    outputQueue;                   ///< Writer thread, if asynchronous
+    ValidationMode validationMode; ///< How mutants are syntax checked
+    bool usePreamble;              ///< If reuse a precompiled preamble
+    ::std::unique_ptr<ValidationSession>
+    validationSession;             ///< Validation session of the target
+    unsigned validationJobs;       ///< Number of validation threads
+    ValidationCache *validationCache; ///< Verdicts cache, not owned
+    bool usePrefilter;             ///< If the lexical prefilter is used
+    ValidationStatistics validationStatistics; ///< Checks counters
+    ::std::unique_ptr<ValidationPool>
+    validationPool;                ///< Validation threads, if parallel
+    unsigned validationBatch;      ///< Clones checked in a single parse
+    ::std::unique_ptr<MutantBatch>
+    openBatch;                     ///< Batch being filled, if batching
+    bool paranoid;                 ///< If the syntax safe mutants are checked
+    bool useOperatorValidator;     ///< If the AST validator is used
+    bool deduplicate;              ///< If the duplicate mutants are aliased
+    ::std::unordered_map<ValidationCache::KeyType, mutant::IdType>
+    firstOccurrences;              ///< First occurrence of each mutant code
+    mutant::IdScheme idScheme;     ///< How the ids are assigned
+    mutant::LocationIdMap locationIds; ///< Location-derived ids
+    ::std::map<mutant::IdType, mutant::IdType>
+    mutantIds;                     ///< Assigned id of each internal one
+    unsigned shardIndex;           ///< Shard of the run
+    unsigned shardCount;           ///< Number of shards, 1 if not sharded
 
     ::std::string outputDirectory; ///< Output directory in which write outputs,
     ///it's saved as absolute path
+    bool generateBinaryReport;     ///< If the binary report is written
+    ::std::unique_ptr<mutant::BinaryReportWriter>
+    binaryReport;                  ///< Binary report, during the analysis
+    mutant::RunMetadataStore *
+    runMetadataStore;              ///< Metadata store of the run, if used
+    ::std::unique_ptr<mutant::MetadataStore>
+    metadataStore;                 ///< Metadata store, during the analysis
     ::std::ofstream reportStream;
+    ::std::vector<char> reportBuffer; ///< Buffer of the report stream
+    ::std::unique_ptr<compression::GzipOStream>
+    compressedReportStream;        ///< Report stream, if compressed
 };
 } // End chimera namespace
 
@@ -27,6 +27,8 @@
 #ifndef INCLUDE_MUTATOR_H_
 #define INCLUDE_MUTATOR_H_
 
+#include "Core/Mutant.h"
+
 #include "clang/AST/ASTTypeTraits.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
@@ -37,6 +39,11 @@
 
 namespace chimera
 {
+namespace mutant
+{
+class MetadataStore;
+} // End mutant namespace
+
 namespace mutator
 {
 
@@ -128,6 +135,34 @@ public:
         return isHOM;
     }
 
+    /// @brief If a mutation type preserves the syntax and the types of the
+    /// matched code, i.e. if a valid code stays valid once mutated
+    /// @details The mutants of such types skip the syntax check, unless the
+    ///          mutation template is paranoid. The answer holds for the
+    ///          matched node only: the code expanded from macros, the
+    ///          templates and their instantiations share the text with other
+    ///          uses, that the mutator can't see. Default false.
+    /// @param node The matched node
+    /// @param type The mutation type
+    virtual bool isSyntaxSafe ( const NodeType &node, MutatorType type ) const {
+        return false;
+    }
+
+    /// @brief Describe a mutation type as the replacement of the operator of
+    /// a builtin binary operation, that keeps the operands text unchanged
+    /// @details It lets the mutants be validated on the AST of the original,
+    ///          without a reparse. Default false.
+    /// @param node The matched node
+    /// @param type The mutation type
+    /// @param op Set to the replaced operation
+    /// @param replacement Set to the new operator
+    /// @retval bool If the mutation is an operator replacement
+    virtual bool getOperatorReplacement ( const NodeType &node, MutatorType type,
+                                          const clang::BinaryOperator *&op,
+                                          clang::BinaryOperatorKind &replacement ) {
+        return false;
+    }
+
     /// @brief Return the local additional compile commands
     /// @return string Containing valid clang compile commands
     const ::std::vector<::std::string> &getAdditionalCompileCommands() {
@@ -227,6 +262,14 @@ public:
     /// @param mutantPath
     virtual void onCreatedMutant ( const ::std::string &mutantPath ) {}
 
+    /// @brief Called in place of onCreatedMutant when the metadata of the
+    ///        mutants are kept in a single store instead of the mutant
+    ///        directories.
+    /// @param id Mutant unique id
+    /// @param store Store of the target
+    virtual void storeMetadata ( mutant::IdType id,
+                                 mutant::MetadataStore &store ) {}
+
     /// @brief It is called at the end of the translation unit, after all the
     /// mutants creation
     /// @param dirPath Path to the directory in which artifacts can be saved
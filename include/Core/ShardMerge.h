@@ -0,0 +1,69 @@
+//===- ShardMerge.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ShardMerge.h
+/// \author Federico Iannucci
+/// \brief This file contains the merge of the outputs of a sharded run
+/// \details A run split in N shards writes the outputs of shard i in
+///          <output dir>/shard-<i>-of-<N>/. The shards of a target are
+///          merged in <output dir>/mutants/<file>/: the reports sorted by
+///          id, the id maps with a new dense index, the mutant directories,
+///          and the patch and archive storages rebuilt with the mutants of
+///          all the shards. The metadata stores of the shards are merged in
+///          <output dir>/metadata.archive.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_CORE_SHARDMERGE_H_
+#define INCLUDE_CORE_SHARDMERGE_H_
+
+#include <string>
+#include <vector>
+
+namespace chimera {
+namespace mutant {
+
+/// @brief Return the name of the output directory of a shard
+::std::string getShardDirectoryName(unsigned index, unsigned count);
+
+/// @brief Merge the outputs of the shards of a target
+/// @param shardDirectories The target output directories of the shards, with
+///        the trailing path separator
+/// @param outputDirectory The merged target output directory, with the
+///        trailing path separator
+/// @param filename The target file name
+/// @return If all the outputs are merged. If two shards took the same
+///         mutant id, nothing is written.
+bool mergeShards(const ::std::vector<::std::string> &shardDirectories,
+                 const ::std::string &outputDirectory,
+                 const ::std::string &filename);
+
+/// @brief Merge the metadata stores of the shards of a run
+/// @param shardDirectories The output directories of the shards, with the
+///        trailing path separator. The ones without a store are skipped.
+/// @param outputDirectory The merged output directory, with the trailing
+///        path separator
+/// @return If all the stores are merged
+bool mergeMetadataStores(const ::std::vector<::std::string> &shardDirectories,
+                         const ::std::string &outputDirectory);
+
+}  // End chimera::mutant namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_CORE_SHARDMERGE_H_ */
@@ -28,6 +28,7 @@
 
 #define ELPP_NO_DEFAULT_LOG_FILE            ///< Disable default logs folder.
 #define ELPP_DISABLE_DEFAULT_CRASH_HANDLING ///< Disable crash handling
+#define ELPP_THREAD_SAFE                    ///< Targets are logged concurrently
 #include "lib/easylogging++.h"
 
 namespace chimera {
@@ -139,7 +140,7 @@ public:
 private:
   static const char *loggerName;
   static el::Configurations configurator;
-  static VerboseLevel actualVLevel;
+  static thread_local VerboseLevel actualVLevel; ///< Per thread indentation
 };
 }
 }
@@ -59,6 +59,12 @@ public:
     virtual clang::Rewriter &mutate ( const chimera::mutator::NodeType &node,
                                       mutator::MutatorType type,
                                       clang::Rewriter &rw ) override; // mutation rules
+    virtual bool isSyntaxSafe ( const chimera::mutator::NodeType &node,
+                                mutator::MutatorType type ) const override; // < and <= are valid where > is
+    virtual bool getOperatorReplacement ( const chimera::mutator::NodeType &node,
+                                          mutator::MutatorType type,
+                                          const clang::BinaryOperator *&op,
+                                          clang::BinaryOperatorKind &replacement ) override; // for the AST validation
 };
 
 /// \}
@@ -72,6 +72,8 @@ class MutatorLoopPerforation2 : public chimera::mutator::Mutator
                                       clang::Rewriter &rw ) override; // mutation rulesi
 
     virtual void onCreatedMutant(const ::std::string &mutantPath) override;
+    virtual void storeMetadata(::chimera::mutant::IdType id,
+                               ::chimera::mutant::MetadataStore &store) override;
   private: 
     const ::clang::BinaryOperator *cond; // < Retrive ForStmt condition  
     const ::clang::BinaryOperator *init; 
@@ -67,9 +67,14 @@ namespace chimera
                                         ::chimera::mutator::MutatorType type,
                                         clang::Rewriter& rw) override;
       virtual void onCreatedMutant(const ::std::string&) override;
+      virtual void storeMetadata(::chimera::mutant::IdType id,
+                                 ::chimera::mutant::MetadataStore &store) override;
 
      private:
       unsigned int operationCounter;  ///< Counter to keep tracks of done mutations
+      /// @brief Resolve the operands produced by other operations
+      ::std::vector<MutationInfo> resolveMutationsInfo_() const;
+
       ::std::vector<MutationInfo> mutationsInfo;  ///< It maintains info about mutations, in order to be saved
     };
 
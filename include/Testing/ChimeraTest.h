@@ -27,6 +27,7 @@
 #ifndef INCLUDE_TEST_CHIMERATEST_H_
 #define INCLUDE_TEST_CHIMERATEST_H_
 
+#include "Core/MutantStorage.h"
 #include "lib/gtest/gtest.h" ///< Include gtest.h to use Google Test Framework
 
 #include <string>
@@ -87,6 +88,81 @@ template <class MutatorClass> void testMutatorMatch()
     testMutatorMatch ( &mutator );
 }
 
+/// @brief Test the eviction of the least recently used verdicts of the
+///        validation cache
+void testValidationCacheEviction();
+
+/// @brief Test the validation cache written and loaded back
+/// @details The verdicts must be loaded in their order of use, the dtor
+///          must flush them.
+void testValidationCacheRoundTrip();
+
+/// @brief Test the bisection of the steps of a deferred mutant
+/// @details Only the broken steps must be dropped, a valid mutant must be
+///          checked once.
+void testDeferredMutant();
+
+/// @brief Test the edited region found by the prefilter
+/// @details The vectorized scans must give the common prefix and suffix of
+///          a scalar scan, for lengths and edits around their chunks.
+void testPrefilterEditedRegion();
+
+/// @brief Test the counts of the prefilter
+/// @details Lone and paired brackets and quotes are placed across the
+///          chunks of the edited region, the verdicts must follow them.
+void testPrefilterCounts();
+
+/// @brief Test the verdicts of the prefilter
+/// @details The brackets in literals and comments and the escaped quotes
+///          must not be judged.
+void testPrefilterVerdicts();
+
+/// @brief Test the verdicts of the AST validator of the operator
+///        replacements
+/// @details The builtin operations on arithmetic operands must be decided
+///          as the frontend does on the mutant, the others left unknown.
+void testOperatorValidatorVerdicts();
+
+/// @brief Test the command lines accepted by the AST validator
+/// @details The warnings promoted to errors must disable it.
+void testOperatorValidatorCommandLine();
+
+#define CHIMERA_STORAGE_TEST(storage_format, compress, test_name)             \
+  TEST(mutant_storage, test_name) {                                            \
+    ::chimera::testing::testStorage(storage_format, compress);                 \
+  }
+
+/// @brief Test a storage of the mutants
+/// @details  The storage fixtures are in the directory storage, next to the
+///           test directory: test_N.cpp is a target, from 0 onwards, and
+///           test_N_mutant_M.cpp its mutant with id M, from 1 onwards.
+///           The mutants of each target are stored in the given format and
+///           as a copy per mutant, then read back as -extract does: both
+///           must give the fixtures.
+/// @param format The storage format
+/// @param compress If the storage is compressed
+void testStorage ( ::chimera::mutant::StorageFormat format, bool compress );
+
+/// @brief Test the location-derived mutant ids
+/// @details The same location mutated twice must be probed, an id must not
+///          depend on the other mutations and the map must be sorted by
+///          key.
+void testLocationIds();
+
+#define CHIMERA_SHARD_MERGE_TEST(storage_format, test_name)                   \
+  TEST(shard_merge, test_name) {                                               \
+    ::chimera::testing::testShardMerge(storage_format);                        \
+  }
+
+/// @brief Test the merge of the outputs of two shards
+/// @details The mutants of the first storage fixture, test_0.cpp, are split
+///          in two shards, each with its report, its location ids and its
+///          storage in the given format. The merge must give all the
+///          mutants and the report sorted by id. A third shard taking an id
+///          of the first two must stop the merge before any write.
+/// @param format The storage format of the shards
+void testShardMerge ( ::chimera::mutant::StorageFormat format );
+
 /// @brief Run all tests
 /// @param argc Like main's argc
 /// @param argv Like main's argv, to configure gtest
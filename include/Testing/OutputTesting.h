@@ -0,0 +1,53 @@
+//===- OutputTesting.h ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file OutputTesting.h
+/// \author Federico Iannucci
+/// \brief This file is used to test the outputs of the mutants: their
+///        storages, their ids and the merge of the shards.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TESTING_OUTPUT_TESTING_H_
+#define INCLUDE_TESTING_OUTPUT_TESTING_H_
+
+#include "Testing/ChimeraTest.h"
+
+/// \addtogroup OUTPUT_TESTING Test cases for the outputs of the mutants
+/// \{
+// Test storages
+CHIMERA_STORAGE_TEST ( ::chimera::mutant::FilesStorage, false, files );
+CHIMERA_STORAGE_TEST ( ::chimera::mutant::FilesStorage, true, compressed_files );
+CHIMERA_STORAGE_TEST ( ::chimera::mutant::PatchStorage, false, patch );
+CHIMERA_STORAGE_TEST ( ::chimera::mutant::ArchiveStorage, false, archive );
+CHIMERA_STORAGE_TEST ( ::chimera::mutant::ArchiveStorage, true, compressed_archive );
+
+// Test mutant ids
+TEST ( mutant_ids, location_ids )
+{
+    ::chimera::testing::testLocationIds();
+}
+
+// Test shard merges
+CHIMERA_SHARD_MERGE_TEST ( ::chimera::mutant::FilesStorage, files );
+CHIMERA_SHARD_MERGE_TEST ( ::chimera::mutant::PatchStorage, patch );
+CHIMERA_SHARD_MERGE_TEST ( ::chimera::mutant::ArchiveStorage, archive );
+/// \}
+
+#endif /* INCLUDE_TESTING_OUTPUT_TESTING_H_ */
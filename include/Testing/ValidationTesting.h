@@ -0,0 +1,76 @@
+//===- ValidationTesting.h --------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ValidationTesting.h
+/// \author Federico Iannucci
+/// \brief This file is used to test the validation of the mutants: the
+///        cache of the verdicts, the deferred checks of the HOM mutants, the
+///        prefilter and the AST validator.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TESTING_VALIDATION_TESTING_H_
+#define INCLUDE_TESTING_VALIDATION_TESTING_H_
+
+#include "Testing/ChimeraTest.h"
+
+/// \addtogroup VALIDATION_TESTING Test cases for the validation of the mutants
+/// \{
+// Test the validation cache
+TEST ( validation_cache, lru_eviction )
+{
+    ::chimera::testing::testValidationCacheEviction();
+}
+TEST ( validation_cache, round_trip )
+{
+    ::chimera::testing::testValidationCacheRoundTrip();
+}
+
+// Test deferred mutants
+TEST ( deferred_mutant, bisection )
+{
+    ::chimera::testing::testDeferredMutant();
+}
+
+// Test the prefilter
+TEST ( prefilter, edited_region )
+{
+    ::chimera::testing::testPrefilterEditedRegion();
+}
+TEST ( prefilter, counts )
+{
+    ::chimera::testing::testPrefilterCounts();
+}
+TEST ( prefilter, verdicts )
+{
+    ::chimera::testing::testPrefilterVerdicts();
+}
+
+// Test the AST validator
+TEST ( operator_validator, verdicts )
+{
+    ::chimera::testing::testOperatorValidatorVerdicts();
+}
+TEST ( operator_validator, command_line )
+{
+    ::chimera::testing::testOperatorValidatorCommandLine();
+}
+/// \}
+
+#endif /* INCLUDE_TESTING_VALIDATION_TESTING_H_ */
@@ -30,6 +30,8 @@
 
 #include "llvm/ADT/StringMap.h"
 
+#include <functional>
+
 // Forward declarations
 namespace clang { namespace tooling { class CompilationDatabase; } }
 
@@ -40,6 +42,9 @@ namespace chimera
 using MutationOperatorPtrMap =
     ::llvm::StringMap<m_operator::MutationOperatorPtr>;
 ///< Map of MutationOperator ptr
+using MutationOperatorFactory =
+    ::std::function<m_operator::MutationOperatorPtr()>;
+///< Function that creates a new instance of a MutationOperator
 
 struct SourcePreprocessingOptions {
     bool Preprocess : 1; ///< Preprocess the input (equivalent to -E), include
@@ -67,6 +72,14 @@ public:
     /// operation fails.
     bool registerMutationOperator ( m_operator::MutationOperatorPtr );
 
+    /// \brief Register a mutation operator by its factory
+    /// \details The sources processed concurrently need their own instances
+    /// of the operators, only the ones registered by factory can be.
+    /// \param The function that creates the mutation operator
+    /// \return If succeeded, if the operator's identifier already exists the
+    /// operation fails.
+    bool registerMutationOperator ( MutationOperatorFactory );
+
     /// \brief Unregister a mutation operator
     /// \param The identifier of the mutation operator
     /// \return If succeeded, id est the operator was registered
@@ -84,6 +97,8 @@ public:
 private:
     ::clang::tooling::CompilationDatabase *compilationDatabasePtr;
     MutationOperatorPtrMap registeredOperatorMap;
+    ::llvm::StringMap<MutationOperatorFactory>
+    operatorFactoryMap; ///< Factory of the operators, if registered by one
 };
 } // End chimera namespace
 
@@ -28,8 +28,11 @@
 #define SRC_INCLUDE_COMPILATIONDATABASEUTILS_H_
 
 #include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
 
+#include <map>
 #include <string>
 #include <vector>
 #include <ostream>
@@ -44,7 +47,43 @@ void dump(std::ostream&, const ::clang::tooling::CompileCommand&);
 void dump(std::ostream&, const CompileCommandVector&);
 void dump(std::ostream&, const ::clang::tooling::CompilationDatabase&);
 
+/// @brief Index of the files of a compilation database, to find the one
+/// of a filepath without comparing it with all of them
+/// @details The files are indexed once by their normalized absolute path. A
+///          filepath that doesn't match any of them, as a symlink, is looked
+///          up by its file id (device and inode), the files are indexed by id
+///          at the first of these lookups. Not thread safe.
+class CompileCommandIndex {
+ public:
+  /// @brief Ctor, it indexes the paths of the files
+  /// @param database The CompilationDatabase, it must outlive the index
+  explicit CompileCommandIndex(
+      const clang::tooling::CompilationDatabase &database);
+
+  /// @brief Find the file of the database equivalent to a filepath
+  /// @param filepath The filepath to look up
+  /// @param file Set to the file of the database
+  /// @return If found. A database without files, as one provided by hand,
+  ///         has all of them, and file is set to filepath.
+  bool find(llvm::StringRef filepath, std::string &file);
+
+  /// @brief Retrieve the compile commands of a filepath
+  CompileCommandVector getCompileCommands(llvm::StringRef filepath);
+
+ private:
+  /// @brief Index the files by id
+  void indexIds_();
+
+  const clang::tooling::CompilationDatabase &database;
+  std::vector<std::string> files;     ///< The files of the database
+  llvm::StringMap<std::size_t> paths; ///< File of each normalized path
+  std::map<llvm::sys::fs::UniqueID, std::size_t> ids; ///< File of each id
+  bool idsIndexed;                    ///< If the ids have been indexed
+};
+
 /// @brief Retrieve the compile commands from a compilation database given a filepath.
+/// @details For more filepaths, a CompileCommandIndex indexes the database
+///          once.
 /// @param database The CompilationDabatase.
 /// @param filepath The filepath to use.
 /// @return The vector of compile command
@@ -0,0 +1,145 @@
+//===- Coordinator.h --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file Coordinator.h
+/// \author Federico Iannucci
+/// \brief This file contains the coordinator and the workers of a
+///        distributed run
+/// \details The coordinator holds the queue of the work units and listens on
+///          a TCP address. Each worker connects and pulls a unit at a time,
+///          so the faster workers take more units. Over the connection each
+///          message is its size (64 bits) and a payload, little endian, that
+///          starts with the message kind:
+///          - hello, worker: "chimera-worker", protocol version,
+///          - unit, coordinator: the unit to process,
+///          - done, coordinator: no more units, the worker ends,
+///          - file, worker: an output of the unit, path and content,
+///          - result, worker: the unit is processed, with its status,
+///          - heartbeat, worker: the unit is in progress.
+///          A unit is queued again if its worker disconnects, or stays
+///          silent, before the result, and it fails after a few attempts.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_COORDINATOR_H_
+#define INCLUDE_TOOLING_COORDINATOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace chimera {
+namespace distributed {
+
+/// @brief A unit of work: the mutations of some functions of a source file
+struct WorkUnit {
+  unsigned id;                              ///< Set by the coordinator
+  ::std::string sourcePath;                 ///< Path of the source file
+  ::std::vector<::std::string> functions;   ///< Target functions, all if empty
+  ::std::vector<::std::string> operators;   ///< Operators to apply
+  ::std::string directory;                  ///< Directory of the command
+  ::std::vector<::std::string> commandLine; ///< Compile command line
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Coordinator of a distributed run
+/// @details The outputs of a unit are written in
+///          <output dir>/units/unit-<id>/, a target output directory of its
+///          source file, to be merged as the shards.
+class Coordinator {
+ public:
+  /// @brief Ctor
+  /// @param outputDirectory The output directory, with the trailing path
+  ///        separator
+  explicit Coordinator(::std::string outputDirectory);
+  ~Coordinator();
+
+  Coordinator(const Coordinator &) = delete;
+  Coordinator &operator=(const Coordinator &) = delete;
+
+  /// @brief Queue a unit, it sets its id. Thread safe, before run.
+  void addUnit(WorkUnit unit);
+
+  ::std::size_t size() const { return this->units.size(); }
+
+  /// @brief Listen for the workers
+  /// @param address [host:]port, all the interfaces if the host is omitted
+  /// @return If the address is bound
+  bool listen(const ::std::string &address);
+
+  /// @brief Hand out the units to the workers until all of them are done
+  /// @return If all the units succeeded
+  bool run();
+
+  /// @brief Return the output directories of the done units, per target
+  /// file name
+  const ::std::map<::std::string, ::std::vector<::std::string>> &
+  getOutputs() const {
+    return this->outputs;
+  }
+
+ private:
+  /// @brief Serve a worker, thread body
+  void serve_(int fd);
+  /// @brief Take the next unit, waiting while other workers could fail
+  /// @return If there is one, false once all the units are done
+  bool takeUnit_(::std::size_t &index);
+  /// @brief Mark a unit as done or queue it again
+  /// @param finished If the worker sent the result
+  /// @param succeeded If the worker processed the unit
+  void completeUnit_(::std::size_t index, bool finished, bool succeeded);
+
+  ::std::string outputDirectory;  ///< Output directory
+  int listenFD;                   ///< Listening socket, -1 if not bound
+  ::std::vector<WorkUnit> units;  ///< All the units, by id
+  ::std::mutex mutex;             ///< It guards the following members
+  ::std::vector<unsigned> attempts;  ///< Times each unit was handed out
+  ::std::condition_variable changed; ///< Signaled when a unit completes
+  ::std::deque<::std::size_t> queue; ///< Units to hand out
+  ::std::size_t pending;          ///< Units not done
+  bool failed;                    ///< If a unit failed
+  ::std::set<int> connections;    ///< Sockets of the workers
+  ::std::map<::std::string, ::std::vector<::std::string>>
+  outputs;                        ///< Output directories per file name
+};
+
+/// @brief Function that processes a unit, it receives the output directory
+/// and returns if the unit succeeded
+using UnitProcessor =
+    ::std::function<bool(const WorkUnit &, const ::std::string &)>;
+
+/// @brief Process the units of a coordinator until it has no more
+/// @param address host:port of the coordinator
+/// @param scratchDirectory Where the outputs of a unit are written before
+///        being sent, with the trailing path separator
+/// @param process The processor of the units
+/// @return If all the units are processed and sent
+bool runWorker(const ::std::string &address,
+               const ::std::string &scratchDirectory,
+               const UnitProcessor &process);
+
+}  // End chimera::distributed namespace
+}  // End chimera namespace
+
+#endif /* INCLUDE_TOOLING_COORDINATOR_H_ */
@@ -0,0 +1,89 @@
+//===- DeferredMutant.h -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file DeferredMutant.h
+/// \author Federico Iannucci
+/// \brief This file contains the class DeferredMutant
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_DEFERREDMUTANT_H_
+#define INCLUDE_TOOLING_DEFERREDMUTANT_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace chimera {
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief A mutant built by steps, validated once all the steps are done
+/// @details Each step is recorded as the region of the code it changed. The
+///          whole mutant is checked once: if it fails, the steps are bisected,
+///          each half is kept if it checks together with the steps kept so
+///          far, so k broken steps out of N cost about k log N checks. A step
+///          that edits, or touches, the text of a dropped step is dropped too.
+class DeferredMutant {
+ public:
+  /// @brief Function that checks a code
+  using Checker = ::std::function<bool(const ::std::string &)>;
+
+  /// @brief Ctor
+  /// @param original The code before the first step
+  explicit DeferredMutant(::std::string original);
+
+  /// @brief Record a step
+  /// @param code The whole code after the step
+  void addStep(const ::std::string &code);
+
+  ::std::size_t getSteps() const { return this->steps.size(); }
+
+  /// @brief Validate the mutant, dropping the steps that break it
+  /// @param check The syntax check
+  /// @param code Set to the code with the kept steps
+  /// @param checks Set to the number of checks done
+  /// @return Per step, if it is kept
+  ::std::vector<bool> validate(const Checker &check, ::std::string &code,
+                               unsigned &checks) const;
+
+ private:
+  /// @brief A step: it replaced [begin, end) of the previous code with text
+  struct Step {
+    ::std::size_t begin;
+    ::std::size_t end;
+    ::std::string text;
+  };
+
+  /// @brief Apply the kept steps to the original
+  /// @param keep Per step, if it is applied. The steps that conflict with a
+  ///        dropped one are set to false.
+  ::std::string compose_(::std::vector<bool> &keep) const;
+  /// @brief Decide the steps in [first, last), the ones before are decided
+  void bisect_(const Checker &check, ::std::vector<bool> &keep,
+               ::std::size_t first, ::std::size_t last, ::std::string &code,
+               unsigned &checks) const;
+
+  ::std::string original;     ///< Code before the first step
+  ::std::string last;         ///< Code after the last step
+  ::std::vector<Step> steps;  ///< The steps, in order
+};
+
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_DEFERREDMUTANT_H_ */
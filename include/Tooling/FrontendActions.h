@@ -46,6 +46,17 @@ namespace chimera {
 int checkSyntaxAction(const ::clang::tooling::CompileCommand&,
                       const std::string& sourceFilePath);
 
+/// @brief Check the syntax of in-memory code as if it were the source file
+/// @details The code is mapped over sourceFilePath through an overlay of the
+///          real file system, so nothing is written on disk and the includes
+///          are resolved as for the original file.
+/// @param The compile command for the source file
+/// @param sourceFilePath The path to the source file
+/// @param code The content to use in place of the source file
+int checkSyntaxActionOnCode(const ::clang::tooling::CompileCommand&,
+                            const std::string& sourceFilePath,
+                            ::llvm::StringRef code);
+
 /// @brief Put on an raw_ostream the function definitions in the sourceFilePath
 /// @param Output stream
 /// @param The compile command for the source file
@@ -0,0 +1,76 @@
+//===- LexicalPrefilter.h ---------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file LexicalPrefilter.h
+/// \author Federico Iannucci
+/// \brief This file contains a lexical filter run before the syntax check
+/// \details The filter compares only the edited region of a mutant, namely
+///          what remains stripping the prefix and the suffix in common with
+///          the original. The original is valid, so the region must keep the
+///          same bracket, brace and double quote balance: the text around it
+///          contributes equally to both. The scan is vectorized with SSE2
+///          when available.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_LEXICALPREFILTER_H_
+#define INCLUDE_TOOLING_LEXICALPREFILTER_H_
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstddef>
+
+namespace chimera {
+namespace prefilter {
+
+/// @brief Outcome of the filter
+enum Verdict {
+  Plausible,          ///< The mutant has to be checked by the frontend
+  UnbalancedParens,   ///< ( ) balance changed
+  UnbalancedBrackets, ///< [ ] balance changed
+  UnbalancedBraces,   ///< { } balance changed
+  UnbalancedQuotes,   ///< " parity changed
+  NumVerdicts
+};
+
+/// @brief Find the edited region of a mutant
+/// @param original The code the mutant derives from
+/// @param mutant The mutant code
+/// @param prefix Set to the length of the common prefix
+/// @param suffix Set to the length of the common suffix, not overlapping the
+///        prefix
+void findEditedRegion(::llvm::StringRef original, ::llvm::StringRef mutant,
+                      ::std::size_t &prefix, ::std::size_t &suffix);
+
+/// @return A printable name for the verdict
+const char *getVerdictName(Verdict v);
+
+/// @brief Check the edited region of a mutant
+/// @details The brackets aren't judged if the region contains quotes or
+///          comments, the quotes if it contains char literals or escapes:
+///          in those cases they could be part of a literal. Only a macro
+///          that expands to a lone bracket could make the filter reject a
+///          mutant that the frontend accepts.
+/// @param original The valid code the mutant derives from
+/// @param mutant The mutant code
+Verdict check(::llvm::StringRef original, ::llvm::StringRef mutant);
+
+}  // end chimera::prefilter namespace
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_LEXICALPREFILTER_H_ */
@@ -0,0 +1,114 @@
+//===- MutantBatch.h --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantBatch.h
+/// \author Federico Iannucci
+/// \brief This file contains the class MutantBatch
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_MUTANTBATCH_H_
+#define INCLUDE_TOOLING_MUTANTBATCH_H_
+
+#include "Tooling/ValidationPool.h"
+#include "Tooling/ValidationSession.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace chimera {
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief A group of consecutive mutants of a target, checked by one job
+/// @details The mutants that edit only the body of a function are checked
+///          all together: the original is extended with a renamed clone of
+///          each mutated function, f__chimera_mut_<n>, inserted right after
+///          the function so that the names visible to it don't change. That
+///          code is parsed once, the errors are attributed to the clones by
+///          offset, and only the implicated mutants are checked one by one.
+///          The other mutants are checked one by one.
+class MutantBatch {
+ public:
+  /// @brief Offsets in the original of a function that can be cloned
+  struct CloneSite {
+    unsigned declBegin; ///< Start of the definition
+    unsigned bodyBegin; ///< Start of the body
+    unsigned declEnd;   ///< Past the end of the body
+    unsigned nameBegin; ///< Start of the name
+    unsigned nameEnd;   ///< Past the end of the name
+  };
+
+  /// @brief Ctor
+  /// @param original The code of the target
+  /// @param maxClones The number of clones that fills the batch
+  MutantBatch(::std::shared_ptr<const ::std::string> original,
+              unsigned maxClones);
+
+  /// @brief Add a mutant to check
+  /// @param code The mutant
+  /// @param site The function containing the mutation, nullptr if it can't
+  ///        be cloned. The mutant is cloned only if all its edits are in the
+  ///        function body.
+  /// @param extraArgs Arguments to append to the compile command
+  void add(ValidationPool::CodePtr code, const CloneSite *site,
+           const ::std::vector<::std::string> &extraArgs);
+
+  /// @brief Add a mutant whose result is already known
+  void addResolved(bool valid);
+
+  /// @return If the batch should be closed
+  bool isFull() const {
+    return this->clones >= this->maxClones ||
+           this->items.size() >= 4 * this->maxClones;
+  }
+
+  const ::std::shared_ptr<const ::std::string> &getOriginal() const {
+    return this->original;
+  }
+
+  /// @brief Check the mutants
+  /// @return The results, in insertion order
+  ::std::vector<bool> check(ValidationSession &session) const;
+
+ private:
+  enum ItemKind { CloneItem, SingleItem, ResolvedItem };
+  struct Item {
+    ItemKind kind;
+    ValidationPool::CodePtr code;
+    ::std::vector<::std::string> extraArgs;
+    CloneSite site;
+    bool valid; ///< The result of a resolved item
+  };
+
+  /// @brief Check together the clone items at indexes
+  void checkClones_(ValidationSession &session,
+                    ::std::vector<::std::size_t> indexes,
+                    ::std::vector<bool> &results) const;
+  /// @brief Return the renamed clone of the function of a clone item
+  ::std::string getCloneCode_(::std::size_t index) const;
+
+  ::std::shared_ptr<const ::std::string> original; ///< Code of the target
+  unsigned maxClones;         ///< Clones that fill the batch
+  unsigned clones;            ///< Number of clone items
+  ::std::vector<Item> items;  ///< The mutants, in insertion order
+};
+
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_MUTANTBATCH_H_ */
@@ -0,0 +1,72 @@
+//===- OperatorValidator.h --------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file OperatorValidator.h
+/// \author Federico Iannucci
+/// \brief This file contains a validator of binary operator replacements
+/// \details The validator decides on the AST of the original, without any
+///          reparse, if replacing the operator of a builtin binary operation
+///          keeps the code valid. It applies the builtin operator rules on the
+///          operand types: the replacement must accept them and give a result
+///          of the same type and value category, and the text must parse with
+///          the same structure. Anything needing the overload resolution, the
+///          template instantiation or a constant evaluation is left undecided.
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_OPERATORVALIDATOR_H_
+#define INCLUDE_TOOLING_OPERATORVALIDATOR_H_
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Expr.h"
+
+#include <string>
+#include <vector>
+
+namespace chimera {
+namespace opvalidator {
+
+/// @brief Outcome of the validator
+enum Verdict {
+  Unknown, ///< Not decided, the mutant has to be checked by the frontend
+  Valid,   ///< The mutant is valid
+  Invalid  ///< The operands are not accepted by the replacement
+};
+
+/// @return A printable name for the verdict
+const char *getVerdictName(Verdict v);
+
+/// @brief If the validator verdicts hold compiling with the command line
+/// @details Warnings promoted to errors aren't predicted, so -Werror and
+///          -pedantic-errors disable the validator
+bool acceptsCommandLine(const ::std::vector<::std::string> &commandLine);
+
+/// @brief Check the replacement of the operator of a binary operation
+/// @details The mutant must contain the text of the operands unchanged, with
+///          the operator token replaced.
+/// @param op The original operation
+/// @param replacement The new operator
+/// @param context The AST context of the original
+Verdict check(const ::clang::BinaryOperator *op,
+              ::clang::BinaryOperatorKind replacement,
+              ::clang::ASTContext &context);
+
+}  // end chimera::opvalidator namespace
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_OPERATORVALIDATOR_H_ */
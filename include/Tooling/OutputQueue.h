@@ -0,0 +1,77 @@
+//===- OutputQueue.h --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file OutputQueue.h
+/// \author Federico Iannucci
+/// \brief This file contains the class OutputQueue
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_OUTPUTQUEUE_H_
+#define INCLUDE_TOOLING_OUTPUTQUEUE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace chimera {
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Thread that performs the writes of the outputs, in push order
+/// @details The matching thread pushes the writes of mutants and reports and
+///          goes on. The queue is bounded, push blocks while it is full.
+class OutputQueue {
+ public:
+  /// @brief A write
+  using Task = ::std::function<void()>;
+
+  /// @brief Ctor, it starts the writer thread
+  /// @param maxPending Max number of writes not done yet
+  explicit OutputQueue(::std::size_t maxPending);
+  /// @brief Dtor, it drains the queue and joins the writer thread
+  ~OutputQueue();
+
+  OutputQueue(const OutputQueue &) = delete;
+  OutputQueue &operator=(const OutputQueue &) = delete;
+
+  /// @brief Queue a write, waiting while the queue is full
+  void push(Task task);
+
+  /// @brief Wait for all the queued writes
+  void drain();
+
+ private:
+  /// @brief Writer thread body
+  void work_();
+
+  ::std::size_t maxPending;      ///< Bound on the queued writes
+  ::std::deque<Task> tasks;      ///< Queued writes
+  bool busy;                     ///< If the writer is doing a write
+  bool stopping;                 ///< If the writer has to exit
+  ::std::mutex mutex;
+  ::std::condition_variable taskAvailable; ///< Signals the writer
+  ::std::condition_variable taskDone;      ///< Signals the pushers
+  ::std::thread thread;
+};
+
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_OUTPUTQUEUE_H_ */
@@ -0,0 +1,109 @@
+//===- ValidationCache.h ----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ValidationCache.h
+/// \author Federico Iannucci
+/// \brief This file contains the class ValidationCache
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_VALIDATIONCACHE_H_
+#define INCLUDE_TOOLING_VALIDATIONCACHE_H_
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace chimera {
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Persistent cache of the syntax check verdicts
+/// @details A verdict is addressed by the MD5 of the checked code, the compile
+///          command and the additional arguments of the mutator. The included
+///          headers aren't hashed: a change in them that flips a verdict
+///          requires to clear the cache.
+///
+///          The cache lives in a single file of the cache directory, loaded at
+///          construction and written back by flush. When full, the least
+///          recently used verdicts are evicted. It is thread safe.
+class ValidationCache {
+ public:
+  using KeyType = ::std::string; ///< Hex digest
+
+  /// @brief Ctor, it loads the cache file if it exists
+  /// @param directory The cache directory
+  /// @param maxEntries Max number of verdicts kept
+  ValidationCache(const ::std::string &directory, ::std::size_t maxEntries);
+  /// @brief Dtor, it flushes the cache
+  ~ValidationCache();
+
+  ValidationCache(const ValidationCache &) = delete;
+  ValidationCache &operator=(const ValidationCache &) = delete;
+
+  /// @brief Compute the key of a check
+  /// @param code The checked code
+  /// @param command The compile command used for the check
+  /// @param extraArgs Arguments appended to the compile command
+  static KeyType computeKey(::llvm::StringRef code,
+                            const ::clang::tooling::CompileCommand &command,
+                            const ::std::vector<::std::string> &extraArgs);
+
+  /// @brief Look up a verdict, marking it as recently used
+  /// @param key The key of the check
+  /// @param valid Set to the verdict if found
+  /// @return If the verdict is cached
+  bool lookup(const KeyType &key, bool &valid);
+
+  /// @brief Insert a verdict, evicting the least recently used if full
+  void insert(const KeyType &key, bool valid);
+
+  /// @brief Write the cache file, if something changed
+  /// @return If the cache is on disk
+  bool flush();
+
+  ::std::size_t getHits() const { return this->hits; }
+  ::std::size_t getMisses() const { return this->misses; }
+
+ private:
+  /// @brief Load the cache file
+  void load_();
+  /// @brief Insert without locking
+  void insert_(const KeyType &key, bool valid);
+
+  using EntryList = ::std::list<::std::pair<KeyType, bool>>;
+
+  ::std::string filePath;   ///< The cache file
+  ::std::size_t maxEntries; ///< Max number of verdicts
+  EntryList entries;        ///< Verdicts, the most recent first
+  ::std::unordered_map<KeyType, EntryList::iterator> index; ///< Key lookup
+  ::std::mutex mutex;
+  bool dirty;           ///< If the file is out of date
+  ::std::size_t hits;   ///< Number of successful lookups
+  ::std::size_t misses; ///< Number of failed lookups
+};
+
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_VALIDATIONCACHE_H_ */
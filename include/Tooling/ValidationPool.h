@@ -0,0 +1,151 @@
+//===- ValidationPool.h -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ValidationPool.h
+/// \author Federico Iannucci
+/// \brief This file contains the class ValidationPool
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_VALIDATIONPOOL_H_
+#define INCLUDE_TOOLING_VALIDATIONPOOL_H_
+
+#include "Tooling/ValidationSession.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace chimera {
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Pool of threads that syntax check the mutants in parallel
+/// @details Each worker owns a ValidationSession. The rendered mutants are
+///          submitted by the matching thread, and their results are committed
+///          on the same thread in submission order, so ids and report entries
+///          don't depend on the scheduling. The number of mutants in flight is
+///          bounded, submit blocks committing the oldest ones when the bound
+///          is reached.
+///
+///          A job checks one or more mutants: consecutive mutants can be
+///          grouped and checked by a single job, see submitToGroup.
+class ValidationPool {
+ public:
+  /// @brief Function called to commit the result of a check, it receives
+  /// the validity and the checked code
+  using CommitCallback = ::std::function<void(bool, const ::std::string &)>;
+  /// @brief Function that creates the session of a worker
+  using SessionFactory = ::std::function<::std::unique_ptr<ValidationSession>()>;
+  /// @brief Shared code of a submitted mutant
+  using CodePtr = ::std::shared_ptr<const ::std::string>;
+  /// @brief Work of a group job, it returns the results of the grouped
+  /// mutants in submission order
+  using GroupWork = ::std::function<::std::vector<bool>(ValidationSession &)>;
+
+  /// @brief Ctor, it starts the workers
+  /// @param workers Number of worker threads
+  /// @param factory Called once per worker, on the worker thread
+  /// @param maxInFlight Max number of submitted and not committed mutants,
+  ///        0 means 4 per worker
+  ValidationPool(unsigned workers, SessionFactory factory,
+                 ::std::size_t maxInFlight = 0);
+  /// @brief Dtor, it drains the pool and joins the workers
+  ~ValidationPool();
+
+  ValidationPool(const ValidationPool &) = delete;
+  ValidationPool &operator=(const ValidationPool &) = delete;
+
+  /// @brief Submit a mutant to check
+  /// @param code The mutant, used as content of the target
+  /// @param extraArgs Arguments to append to the compile command
+  /// @param onCommit Called with the result, on the submitting thread
+  void submit(::std::string code, ::std::vector<::std::string> extraArgs,
+              CommitCallback onCommit);
+
+  /// @brief Submit a mutant whose result is already known, it is committed
+  /// in order with the others
+  /// @param valid The result
+  /// @param code The mutant
+  /// @param onCommit Called with the result, on the submitting thread
+  void submitResolved(bool valid, ::std::string code, CommitCallback onCommit);
+
+  /// @brief Add a mutant to the open group, it is checked by the work passed
+  /// to closeGroup. Nothing is committed while the group is open.
+  /// @param code The mutant
+  /// @param onCommit Called with the result, on the submitting thread
+  /// @return The shared code, for the group work
+  CodePtr submitToGroup(::std::string code, CommitCallback onCommit);
+
+  /// @brief Close the open group, queuing its work
+  /// @param work It checks the grouped mutants
+  void closeGroup(GroupWork work);
+
+  /// @return The number of mutants in the open group
+  ::std::size_t getGroupSize() const { return this->group.size(); }
+
+  /// @brief Wait for all the submitted mutants and commit them, the open
+  /// group must be closed
+  void drain();
+
+  unsigned getWorkers() const { return this->threads.size(); }
+
+ private:
+  /// @brief A job, it checks one or more mutants
+  struct Job {
+    GroupWork work;
+    ::std::vector<bool> results;
+    bool done;
+  };
+  using JobPtr = ::std::shared_ptr<Job>;
+  /// @brief A submitted mutant
+  struct Pending {
+    JobPtr job;          ///< The job that checks it
+    ::std::size_t index; ///< Index of the result in the job
+    CodePtr code;
+    CommitCallback onCommit;
+  };
+
+  /// @brief Queue a job for the mutants, after the pending ones
+  void enqueue_(JobPtr job, ::std::vector<Pending> &mutants);
+  /// @brief Worker thread body
+  void work_();
+  /// @brief Commit the completed jobs at the head of the pending queue
+  /// @param waitUntil Wait for the oldest jobs while more than waitUntil are
+  ///        pending
+  void commit_(::std::size_t waitUntil);
+
+  SessionFactory factory;   ///< Creates the session of a worker
+  ::std::size_t maxInFlight; ///< Bound on the pending mutants
+  ::std::deque<Pending> pending; ///< Submitted mutants, in submission order
+  ::std::deque<JobPtr> queue;    ///< Jobs not taken by a worker yet
+  ::std::vector<Pending> group;  ///< Mutants of the open group
+  ::std::mutex mutex;
+  ::std::condition_variable jobAvailable; ///< Signals the workers
+  ::std::condition_variable jobDone;      ///< Signals the submitter
+  bool stopping;                          ///< If the workers have to exit
+  ::std::vector<::std::thread> threads;
+};
+
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_VALIDATIONPOOL_H_ */
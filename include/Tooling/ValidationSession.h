@@ -0,0 +1,150 @@
+//===- ValidationSession.h --------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ValidationSession.h
+/// \author Federico Iannucci
+/// \brief This file contains the class ValidationSession
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_TOOLING_VALIDATIONSESSION_H_
+#define INCLUDE_TOOLING_VALIDATIONSESSION_H_
+
+#include "Tooling/ValidationCache.h"
+
+#include "clang/Basic/FileManager.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/PCHContainerOperations.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace chimera {
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Long-lived context to syntax check the mutants of a single target
+/// @details The compile command is adapted and parsed into a
+///          CompilerInvocation only once, the driver is not run anymore.
+///          Each check clones the invocation into a fresh CompilerInstance,
+///          overlaying the mutant on the target path. A FileManager is shared
+///          among the checks, so the headers are looked up only once.
+///
+///          If the preamble is enabled, the target is parsed once into an
+///          ASTUnit that precompiles its leading #include/#define block, and
+///          each check reparses only the code after the preamble.
+///
+///          A session isn't thread safe, each thread needs its own.
+class ValidationSession {
+ public:
+  /// @brief Ctor
+  /// @param command The compile command of the target
+  /// @param targetPath The absolute path of the target
+  /// @param usePreamble If reuse a precompiled preamble of the target
+  ValidationSession(const ::clang::tooling::CompileCommand &command,
+                    const ::std::string &targetPath, bool usePreamble = false);
+
+  /// @brief Check the syntax of code, used as content of the target
+  /// @param code The content to check
+  /// @param extraArgs Arguments to append to the compile command
+  /// @return If the code passes the check
+  bool check(::llvm::StringRef code,
+             const ::std::vector<::std::string> &extraArgs =
+                 ::std::vector<::std::string>());
+
+  /// @brief A [begin, end) range of offsets in a checked code
+  using Range = ::std::pair<unsigned, unsigned>;
+
+  /// @brief Check the syntax of code and attribute the errors to ranges
+  /// @details Used to check many mutants in one parse: an error implicates
+  ///          the range that contains it and the preceding one, whose broken
+  ///          text could be the cause. The verdicts aren't cached.
+  /// @param code The content to check
+  /// @param ranges Sorted and disjoint ranges in code
+  /// @param implicated Set, per range, if its code may be invalid
+  /// @param extraArgs Arguments to append to the compile command
+  /// @return false if some errors couldn't be attributed to the ranges
+  bool checkAttributing(::llvm::StringRef code,
+                        const ::std::vector<Range> &ranges,
+                        ::std::vector<bool> &implicated,
+                        const ::std::vector<::std::string> &extraArgs =
+                            ::std::vector<::std::string>());
+
+  /// @defgroup
+  /// @brief Access the verdicts cache, if set
+  /// @{
+  bool lookupCache(::llvm::StringRef code,
+                   const ::std::vector<::std::string> &extraArgs, bool &valid);
+  void storeCache(::llvm::StringRef code,
+                  const ::std::vector<::std::string> &extraArgs, bool valid);
+  /// @}
+
+  const ::std::string &getTargetPath() const { return this->targetPath; }
+
+  const ::clang::tooling::CompileCommand &getCompileCommand() const {
+    return this->command;
+  }
+
+  /// @brief Silence the log messages, for the sessions of the worker threads
+  /// whose output would interleave
+  void setQuiet(bool val) { this->quiet = val; }
+
+  /// @brief Set the verdicts cache consulted before the frontend, nullptr to
+  /// disable it. The session doesn't own it.
+  void setCache(ValidationCache *cache) { this->cache = cache; }
+
+ private:
+  /// @brief Return the invocation for the extra arguments, it is created at
+  /// the first request
+  /// @return nullptr if the compile command can't be parsed
+  ::clang::CompilerInvocation *
+  getInvocation_(const ::std::vector<::std::string> &extraArgs);
+  /// @brief Check code on a clone of invocation
+  bool checkOnInvocation_(const ::clang::CompilerInvocation &invocation,
+                          ::llvm::StringRef code);
+  /// @brief Check code reparsing the preamble unit
+  bool checkOnPreamble_(::llvm::StringRef code);
+  /// @brief Check code running the frontend
+  bool checkUncached_(::llvm::StringRef code,
+                      const ::std::vector<::std::string> &extraArgs);
+
+  using InvocationPtr = ::llvm::IntrusiveRefCntPtr<::clang::CompilerInvocation>;
+
+  ::clang::tooling::CompileCommand command; ///< Adapted compile command
+  ::std::string targetPath;                 ///< Absolute path of the target
+  bool usePreamble;                         ///< If the preamble is reused
+  ::std::shared_ptr<::clang::PCHContainerOperations> pchOperations;
+  ::llvm::IntrusiveRefCntPtr<::clang::FileManager>
+      fileManager; ///< Shared among the checks
+  ::std::map<::std::vector<::std::string>, InvocationPtr>
+      invocations; ///< Parsed invocations, by extra arguments
+  ::std::unique_ptr<::clang::ASTUnit> preambleUnit; ///< Unit with the preamble
+  bool preambleFailed; ///< If the preamble unit can't be built
+  bool quiet;          ///< If the log messages are silenced
+  ValidationCache *cache; ///< Verdicts cache, not owned
+};
+
+}  // end chimera namespace
+#endif /* INCLUDE_TOOLING_VALIDATIONSESSION_H_ */
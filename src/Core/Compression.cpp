@@ -0,0 +1,135 @@
+//===- Compression.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file Compression.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the zlib compression of the outputs
+//===----------------------------------------------------------------------===//
+
+#include "Core/Compression.h"
+
+#include <zlib.h>
+
+using namespace chimera::compression;
+
+/// @brief Size of the buffer of the gzip streams
+static const ::std::size_t gzipBufferSize = 64 * 1024;
+
+bool chimera::compression::compress(::llvm::StringRef data,
+                                    ::std::string &compressed) {
+  uLongf size = ::compressBound(data.size());
+  compressed.resize(size);
+  int status = ::compress2(reinterpret_cast<Bytef *>(&compressed[0]), &size,
+                           reinterpret_cast<const Bytef *>(data.data()),
+                           data.size(), Z_DEFAULT_COMPRESSION);
+  compressed.resize(status == Z_OK ? size : 0);
+  return status == Z_OK;
+}
+
+bool chimera::compression::uncompress(::llvm::StringRef compressed,
+                                      ::std::size_t size,
+                                      ::std::string &data) {
+  data.resize(size);
+  uLongf written = size;
+  // zlib needs a valid pointer also for empty data
+  char empty;
+  int status = ::uncompress(
+      reinterpret_cast<Bytef *>(size != 0 ? &data[0] : &empty), &written,
+      reinterpret_cast<const Bytef *>(compressed.data()), compressed.size());
+  return status == Z_OK && written == size;
+}
+
+GzipOStream::Buffer::Buffer(const ::std::string &path)
+    : file(::gzopen(path.c_str(), "wb")), data(gzipBufferSize) {
+  this->setp(this->data.data(), this->data.data() + this->data.size());
+}
+
+GzipOStream::Buffer::~Buffer() { this->close(); }
+
+bool GzipOStream::Buffer::close() {
+  if (this->file == nullptr) {
+    return false;
+  }
+  bool flushed = this->flush_();
+  bool closed = ::gzclose(static_cast<gzFile>(this->file)) == Z_OK;
+  this->file = nullptr;
+  return flushed && closed;
+}
+
+bool GzipOStream::Buffer::flush_() {
+  int size = this->pptr() - this->pbase();
+  this->setp(this->data.data(), this->data.data() + this->data.size());
+  return size == 0 ||
+         (this->file != nullptr &&
+          ::gzwrite(static_cast<gzFile>(this->file), this->data.data(),
+                    size) == size);
+}
+
+GzipOStream::Buffer::int_type GzipOStream::Buffer::overflow(int_type c) {
+  if (!this->flush_()) {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *this->pptr() = traits_type::to_char_type(c);
+    this->pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int GzipOStream::Buffer::sync() { return this->flush_() ? 0 : -1; }
+
+GzipOStream::GzipOStream(const ::std::string &path)
+    : ::std::ostream(nullptr), buffer(path) {
+  this->rdbuf(&this->buffer);
+  if (!this->buffer.isOpen()) {
+    this->setstate(::std::ios_base::failbit);
+  }
+}
+
+GzipOStream::~GzipOStream() { this->buffer.close(); }
+
+void GzipOStream::close() {
+  if (!this->buffer.close()) {
+    this->setstate(::std::ios_base::failbit);
+  }
+}
+
+bool chimera::compression::writeGzipFile(const ::std::string &path,
+                                         ::llvm::StringRef data) {
+  GzipOStream stream(path);
+  stream.write(data.data(), data.size());
+  stream.close();
+  return !stream.fail();
+}
+
+bool chimera::compression::readGzipFile(const ::std::string &path,
+                                        ::std::string &data) {
+  gzFile file = ::gzopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  data.clear();
+  ::std::vector<char> buffer(gzipBufferSize);
+  int read;
+  while ((read = ::gzread(file, buffer.data(), buffer.size())) > 0) {
+    data.append(buffer.data(), read);
+  }
+  return ::gzclose(file) == Z_OK && read == 0;
+}
@@ -0,0 +1,206 @@
+//===- MetadataStore.cpp ----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MetadataStore.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the store of the metadata of the mutants
+//===----------------------------------------------------------------------===//
+
+#include "Core/MetadataStore.h"
+#include "Core/MutantStorage.h"
+
+#include "llvm/Support/Endian.h"
+
+using namespace chimera::mutant;
+
+const char *const RunMetadataStore::storeFileName = "metadata.archive";
+
+namespace {
+void writeU32(::std::string &out, ::std::uint32_t value) {
+  for (unsigned i = 0; i < 4; ++i) {
+    out.push_back(char(value >> (8 * i)));
+  }
+}
+
+void writeU64(::std::string &out, ::std::uint64_t value) {
+  writeU32(out, ::std::uint32_t(value));
+  writeU32(out, ::std::uint32_t(value >> 32));
+}
+
+void writeString(::std::string &out, const ::std::string &s) {
+  writeU32(out, s.size());
+  out += s;
+}
+
+/// @brief Reader of a record, it fails at the first field out of bounds
+class RecordReader {
+ public:
+  explicit RecordReader(::llvm::StringRef record) : record(record) {}
+
+  bool read(::std::uint32_t &value) {
+    if (this->record.size() < 4) {
+      return false;
+    }
+    value = ::llvm::support::endian::read32le(this->record.data());
+    this->record = this->record.drop_front(4);
+    return true;
+  }
+  bool read(::std::uint64_t &value) {
+    if (this->record.size() < 8) {
+      return false;
+    }
+    value = ::llvm::support::endian::read64le(this->record.data());
+    this->record = this->record.drop_front(8);
+    return true;
+  }
+  bool read(::std::int64_t &value) {
+    ::std::uint64_t u;
+    if (!this->read(u)) {
+      return false;
+    }
+    value = ::std::int64_t(u);
+    return true;
+  }
+  bool read(::std::string &s) {
+    ::std::uint32_t size;
+    if (!this->read(size) || this->record.size() < size) {
+      return false;
+    }
+    s = this->record.substr(0, size).str();
+    this->record = this->record.drop_front(size);
+    return true;
+  }
+
+ private:
+  ::llvm::StringRef record;  ///< What is left to read
+};
+} // end anonymous namespace
+
+void MetadataStore::add(IdType id, MetadataEntry entry) {
+  this->entries[id].push_back(::std::move(entry));
+}
+
+bool RunMetadataStore::add(const ::std::string &target,
+                           const MetadataStore &store) {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  bool added = true;
+  for (const auto &mutant : store.getEntries()) {
+    added &= this->entries
+                 .insert(::std::make_pair(Key(target, mutant.first),
+                                          mutant.second))
+                 .second;
+  }
+  return added;
+}
+
+bool RunMetadataStore::read(const ::std::string &path) {
+  ArchiveMutantReader archive;
+  if (!archive.open(path)) {
+    return false;
+  }
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  bool added = true;
+  for (IdType record : archive.getIds()) {
+    ::std::string data;
+    ::std::string target;
+    IdType id;
+    ::std::vector<MetadataEntry> entries;
+    if (!archive.read(record, data) || !parse(data, target, id, entries)) {
+      return false;
+    }
+    added &= this->entries
+                 .insert(
+                     ::std::make_pair(Key(target, id), ::std::move(entries)))
+                 .second;
+  }
+  return added;
+}
+
+bool RunMetadataStore::write(const ::std::string &path) const {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  ArchiveWriter archive(path);
+  bool ok = archive.isOpen();
+  ::std::string record;
+  IdType number = 0;
+  for (auto it = this->entries.begin(); ok && it != this->entries.end();
+       ++it) {
+    record.clear();
+    writeString(record, it->first.first);
+    writeU64(record, it->first.second);
+    writeU32(record, it->second.size());
+    for (const MetadataEntry &e : it->second) {
+      writeString(record, e.mutator);
+      writeString(record, e.operationId);
+      writeU32(record, e.line);
+      writeString(record, e.returnType);
+      writeString(record, e.operation);
+      writeString(record, e.operand1);
+      writeString(record, e.operand2);
+      writeString(record, e.returnVariable);
+      writeString(record, e.increment);
+      writeU64(record, ::std::uint64_t(e.tripCount));
+    }
+    ok = archive.append(++number, record);
+  }
+  return ok;
+}
+
+bool RunMetadataStore::get(const ::std::string &target, IdType id,
+                           ::std::vector<MetadataEntry> &entries) const {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  auto it = this->entries.find(Key(target, id));
+  if (it == this->entries.end()) {
+    return false;
+  }
+  entries = it->second;
+  return true;
+}
+
+bool RunMetadataStore::empty() const {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  return this->entries.empty();
+}
+
+bool RunMetadataStore::parse(::llvm::StringRef record, ::std::string &target,
+                             IdType &id,
+                             ::std::vector<MetadataEntry> &entries) {
+  RecordReader reader(record);
+  ::std::uint64_t mutantId;
+  ::std::uint32_t count;
+  if (!reader.read(target) || !reader.read(mutantId) || !reader.read(count)) {
+    return false;
+  }
+  id = IdType(mutantId);
+  entries.clear();
+  for (::std::uint32_t i = 0; i < count; ++i) {
+    MetadataEntry e;
+    ::std::uint32_t line;
+    if (!(reader.read(e.mutator) && reader.read(e.operationId) &&
+          reader.read(line) && reader.read(e.returnType) &&
+          reader.read(e.operation) && reader.read(e.operand1) &&
+          reader.read(e.operand2) && reader.read(e.returnVariable) &&
+          reader.read(e.increment) && reader.read(e.tripCount))) {
+      return false;
+    }
+    e.line = line;
+    entries.push_back(::std::move(e));
+  }
+  return true;
+}
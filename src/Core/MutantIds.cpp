@@ -0,0 +1,105 @@
+//===- MutantIds.cpp --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantIds.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the location-derived mutant ids
+//===----------------------------------------------------------------------===//
+
+#include "Core/MutantIds.h"
+
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace chimera::mutant;
+
+const char *const LocationIdMap::mapFileName = "ids.csv";
+
+::std::uint64_t chimera::mutant::computeLocationKey(
+    ::llvm::StringRef file, ::llvm::StringRef function, unsigned line,
+    unsigned column, ::llvm::StringRef mutator, unsigned type) {
+  // Each field is terminated, so different splits don't collide
+  const ::llvm::StringRef terminator("\0", 1);
+  ::llvm::MD5 hash;
+  hash.update(file);
+  hash.update(terminator);
+  hash.update(function);
+  hash.update(terminator);
+  hash.update(::std::to_string(line) + ":" + ::std::to_string(column));
+  hash.update(terminator);
+  hash.update(mutator);
+  hash.update(terminator);
+  hash.update(::std::to_string(type));
+  ::llvm::MD5::MD5Result result;
+  hash.final(result);
+  return ::llvm::support::endian::read64le(&result[0]);
+}
+
+IdType LocationIdMap::assign(::llvm::StringRef file,
+                             ::llvm::StringRef function, unsigned line,
+                             unsigned column, ::llvm::StringRef mutator,
+                             unsigned type, bool &collided) {
+  ::std::uint64_t key =
+      computeLocationKey(file, function, line, column, mutator, type);
+  IdType id = key;
+  collided = false;
+  // The id 0 is reserved
+  while (id == 0 || this->taken.count(id) != 0) {
+    collided |= id != 0;
+    ++id;
+  }
+  this->taken[id] = this->entries.size();
+  this->entries.push_back(
+      Entry{key, id, function.str(), line, column, mutator.str(), type});
+  return id;
+}
+
+bool LocationIdMap::write(const ::std::string &path) const {
+  ::std::vector<const Entry *> sorted;
+  sorted.reserve(this->entries.size());
+  for (const Entry &e : this->entries) {
+    sorted.push_back(&e);
+  }
+  // The same location mutated twice keeps the order of assignment
+  ::std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Entry *a, const Entry *b) {
+                       return a->key < b->key;
+                     });
+  ::std::error_code error;
+  ::llvm::raw_fd_ostream file(path, error, ::llvm::sys::fs::F_Text);
+  if (error) {
+    return false;
+  }
+  file << "Dense,Id,Key,Function,Line,Column,Mutator,Type\n";
+  ::std::size_t dense = 0;
+  for (const Entry *e : sorted) {
+    file << ++dense << "," << e->id << ","
+         << ::llvm::format_hex_no_prefix(e->key, 16) << "," << e->function
+         << "," << e->line << "," << e->column << "," << e->mutator << ","
+         << e->type << "\n";
+  }
+  file.close();
+  return !file.has_error();
+}
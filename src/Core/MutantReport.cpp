@@ -0,0 +1,111 @@
+//===- MutantReport.cpp -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantReport.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the binary columnar report of the mutants
+//===----------------------------------------------------------------------===//
+
+#include "Core/MutantReport.h"
+
+#include <fstream>
+
+using namespace chimera::mutant;
+
+const char *const BinaryReportWriter::reportFileName = "report.bin";
+
+/// @brief Magic number of the report, 8 bytes
+static const char reportMagic[] = "CHMRRPT";
+static const ::std::uint64_t reportVersion = 2;
+
+/// @brief Write an unsigned integer of N bytes, little endian
+template <unsigned N>
+static void writeLE(::std::ostream &os, ::std::uint64_t value) {
+  char bytes[N];
+  for (unsigned i = 0; i < N; ++i) {
+    bytes[i] = char(value >> (8 * i));
+  }
+  os.write(bytes, N);
+}
+
+/// @brief Write a column, sizeof(T) bytes per row, little endian
+template <typename T>
+static void writeColumn(::std::ostream &os, const ::std::vector<T> &column) {
+  // Buffered, so a large column isn't written value by value
+  const unsigned N = sizeof(T);
+  ::std::vector<char> bytes(N * column.size());
+  for (::std::size_t i = 0; i < column.size(); ++i) {
+    for (unsigned b = 0; b < N; ++b) {
+      bytes[N * i + b] = char(::std::uint64_t(column[i]) >> (8 * b));
+    }
+  }
+  os.write(bytes.data(), bytes.size());
+}
+
+::std::uint32_t
+BinaryReportWriter::StringTable::getIndex(const ::std::string &s) {
+  auto inserted = this->indexes.insert(
+      ::std::make_pair(s, ::std::uint32_t(this->strings.size())));
+  if (inserted.second) {
+    this->strings.push_back(&inserted.first->first);
+  }
+  return inserted.first->second;
+}
+
+void BinaryReportWriter::addEntry(IdType id, const ::std::string &functionName,
+                                  unsigned line, unsigned column,
+                                  const ::std::string &mutatorIdentifier,
+                                  unsigned type) {
+  this->ids.push_back(id);
+  this->functionIndexes.push_back(this->functions.getIndex(functionName));
+  this->lines.push_back(line);
+  this->columns.push_back(column);
+  this->mutatorIndexes.push_back(this->mutators.getIndex(mutatorIdentifier));
+  this->types.push_back(type);
+}
+
+bool BinaryReportWriter::write(const ::std::string &path) const {
+  ::std::ofstream report(path, ::std::ofstream::binary);
+  report.write(reportMagic, sizeof(reportMagic));
+  writeLE<8>(report, reportVersion);
+  writeLE<8>(report, this->ids.size());
+  writeLE<8>(report, this->functions.strings.size());
+  writeLE<8>(report, this->mutators.strings.size());
+  ::std::uint64_t size = 40;
+  for (const StringTable *table : {&this->functions, &this->mutators}) {
+    for (const ::std::string *s : table->strings) {
+      writeLE<4>(report, s->size());
+      report << *s;
+      size += 4 + s->size();
+    }
+  }
+  // The columns are aligned
+  for (; size % 8 != 0; ++size) {
+    report.put(0);
+  }
+  writeColumn(report, this->ids);
+  writeColumn(report, this->functionIndexes);
+  writeColumn(report, this->lines);
+  writeColumn(report, this->columns);
+  writeColumn(report, this->mutatorIndexes);
+  writeColumn(report, this->types);
+  report.close();
+  return !report.fail();
+}
@@ -0,0 +1,170 @@
+//===- MutantSink.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantSink.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the consumers of the validated mutants
+//===----------------------------------------------------------------------===//
+
+#include "Core/MutantSink.h"
+#include "Log.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Endian.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef LLVM_ON_UNIX
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace chimera::mutant;
+using namespace chimera::log;
+
+namespace {
+template <typename T> void writeLE(::std::string &out, T value) {
+  char bytes[sizeof(T)];
+  ::llvm::support::endian::write<T, ::llvm::support::little,
+                                 ::llvm::support::unaligned>(bytes, value);
+  out.append(bytes, sizeof(T));
+}
+
+void writeString(::std::string &out, ::llvm::StringRef s) {
+  writeLE<::std::uint32_t>(out, s.size());
+  out.append(s.data(), s.size());
+}
+
+#ifdef LLVM_ON_UNIX
+/// @brief A consumer that goes away is reported as a write error
+void ignoreBrokenPipe() { ::signal(SIGPIPE, SIG_IGN); }
+#endif
+} // end anonymous namespace
+
+StreamMutantSink::~StreamMutantSink() {
+#ifdef LLVM_ON_UNIX
+  if (this->fd != -1) {
+    ::std::string end;
+    writeLE<::std::uint64_t>(end, 0);
+    this->write_(end);
+    ::close(this->fd);
+  }
+#endif
+}
+
+::std::unique_ptr<StreamMutantSink> StreamMutantSink::openStdout() {
+#ifdef LLVM_ON_UNIX
+  // What is already buffered goes before the records
+  ::std::cout.flush();
+  ::std::fflush(stdout);
+  int fd = ::dup(STDOUT_FILENO);
+  if (fd != -1 && ::dup2(STDERR_FILENO, STDOUT_FILENO) != -1) {
+    ignoreBrokenPipe();
+    return ::std::unique_ptr<StreamMutantSink>(new StreamMutantSink(fd));
+  }
+  if (fd != -1) {
+    ::close(fd);
+  }
+#endif
+  return nullptr;
+}
+
+::std::unique_ptr<StreamMutantSink>
+StreamMutantSink::openSocket(const ::std::string &socketPath) {
+#ifdef LLVM_ON_UNIX
+  ::sockaddr_un address;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    ChimeraLogger::error("Socket path too long: " + socketPath);
+    return nullptr;
+  }
+  ::std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  ::std::strcpy(address.sun_path, socketPath.c_str());
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return nullptr;
+  }
+  if (::connect(fd, reinterpret_cast<::sockaddr *>(&address),
+                sizeof(address)) == 0) {
+    ignoreBrokenPipe();
+    return ::std::unique_ptr<StreamMutantSink>(new StreamMutantSink(fd));
+  }
+  ChimeraLogger::error("Couldn't connect to " + socketPath + ": " +
+                       ::std::strerror(errno));
+  ::close(fd);
+#endif
+  return nullptr;
+}
+
+bool StreamMutantSink::consume(const MutantInfo &info, const EditList &edits,
+                               ::llvm::StringRef code) {
+  // The record is built outside of the lock
+  ::std::string r;
+  // The size is set at the end
+  writeLE<::std::uint64_t>(r, 0);
+  writeString(r, info.target);
+  writeLE<::std::uint64_t>(r, info.id);
+  writeLE<::std::uint32_t>(r, info.line);
+  writeLE<::std::uint32_t>(r, info.column);
+  writeLE<::std::uint32_t>(r, info.type);
+  writeString(r, info.functionName);
+  writeString(r, info.mutator);
+  writeLE<::std::uint32_t>(r, edits.size());
+  for (const Edit &e : edits) {
+    writeLE<::std::uint64_t>(r, e.offset);
+    writeLE<::std::uint64_t>(r, e.length);
+    writeString(r, e.replacement);
+  }
+  writeLE<::std::uint64_t>(r, code.size());
+  r.append(code.data(), code.size());
+  ::llvm::support::endian::write64le(&r[0], r.size() - 8);
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  if (this->fd == -1) {
+    return false;
+  }
+  return this->write_(r);
+}
+
+bool StreamMutantSink::write_(::llvm::StringRef data) {
+#ifdef LLVM_ON_UNIX
+  while (!data.empty()) {
+    ssize_t written = ::write(this->fd, data.data(), data.size());
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      ChimeraLogger::error(::std::string("The mutant stream is closed: ") +
+                           ::std::strerror(errno));
+      ::close(this->fd);
+      this->fd = -1;
+      return false;
+    }
+    data = data.drop_front(written);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,678 @@
+//===- MutantStorage.cpp ----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantStorage.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the storages of the generated mutants
+//===----------------------------------------------------------------------===//
+
+#include "Core/MutantStorage.h"
+#include "Core/Compression.h"
+#include "Log.h"
+#include "Tooling/LexicalPrefilter.h"
+#include "Utils.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef LLVM_ON_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace chimera::mutant;
+using namespace chimera::log;
+
+const char *const PatchMutantStorage::patchFileName = "mutants.patch";
+const char *const PatchMutantStorage::originalDirName = "original";
+
+const char *const ArchiveMutantStorage::archiveFileName = "mutants.archive";
+
+/// @brief First line of the patch file
+static const char patchHeader[] = "chimera-patch 1";
+
+/// @brief Magic numbers of the archive header and trailer, 8 bytes each
+static const char archiveMagic[] = "CHMRARC";
+static const char compressedArchiveMagic[] = "CHMRARZ";
+static const char indexMagic[] = "CHMRIDX";
+static const ::std::uint64_t archiveVersion = 1;
+/// @brief Size of the header, of a record header, of an index entry and of
+/// the trailer
+static const ::std::uint64_t archiveHeaderSize = 16;
+static const ::std::uint64_t recordHeaderSize = 16;
+static const ::std::uint64_t indexEntrySize = 24;
+static const ::std::uint64_t trailerSize = 24;
+
+static void writeU64(::llvm::raw_ostream &os, ::std::uint64_t value) {
+  char bytes[8];
+  for (unsigned i = 0; i < 8; ++i) {
+    bytes[i] = char(value >> (8 * i));
+  }
+  os.write(bytes, 8);
+}
+
+static ::std::uint64_t readU64(const char *data) {
+  return ::llvm::support::endian::read64le(data);
+}
+
+/// @brief Untouched spans shorter than this are written from memory, the
+/// in-kernel copy doesn't pay off
+static const ::std::size_t minCopySpan = 64 * 1024;
+
+#ifdef LLVM_ON_UNIX
+/// @brief Write all the buffers, retrying on partial writes
+static bool writeAll(int fd, ::std::vector<struct iovec> &buffers) {
+  ::std::size_t first = 0;
+  while (first < buffers.size()) {
+    int count = ::std::min<::std::size_t>(buffers.size() - first, IOV_MAX);
+    ssize_t written = ::writev(fd, &buffers[first], count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    // Skip what is written
+    ::std::size_t left = written;
+    while (first < buffers.size() && left >= buffers[first].iov_len) {
+      left -= buffers[first].iov_len;
+      ++first;
+    }
+    if (left != 0) {
+      buffers[first].iov_base = static_cast<char *>(buffers[first].iov_base) +
+                                left;
+      buffers[first].iov_len -= left;
+    }
+  }
+  return true;
+}
+
+/// @brief Copy [offset, offset + size) of a file in the kernel
+/// @param supported Set to false if the copy isn't supported between the
+///        files, nothing is copied then
+static bool copyRange(int in, ::std::size_t offset, ::std::size_t size,
+                      int out, bool &supported) {
+#ifdef SYS_copy_file_range
+  loff_t position = offset;
+  bool first = true;
+  while (size != 0) {
+    long copied = ::syscall(SYS_copy_file_range, in, &position, out, nullptr,
+                            size, 0u);
+    if (copied < 0 && errno == EINTR) {
+      continue;
+    }
+    if (copied <= 0) {
+      // Not supported, or across file systems
+      if (first && (copied == 0 || errno == ENOSYS || errno == EXDEV ||
+                    errno == EINVAL || errno == EOPNOTSUPP)) {
+        supported = false;
+      }
+      return false;
+    }
+    first = false;
+    size -= copied;
+  }
+  return true;
+#else
+  supported = false;
+  return false;
+#endif
+}
+#endif
+
+EditList chimera::mutant::computeEdits(::llvm::StringRef original,
+                                       ::llvm::StringRef code) {
+  // The mutations are local, the region between the common prefix and
+  // suffix is compact
+  ::std::size_t prefix, suffix;
+  prefilter::findEditedRegion(original, code, prefix, suffix);
+  EditList edits;
+  if (original != code) {
+    edits.push_back(
+        Edit{prefix, original.size() - prefix - suffix,
+             code.substr(prefix, code.size() - prefix - suffix).str()});
+  }
+  return edits;
+}
+
+::std::string chimera::mutant::applyEdits(::llvm::StringRef original,
+                                          const EditList &edits) {
+  ::std::string code;
+  code.reserve(original.size());
+  ::std::size_t copied = 0;
+  for (const Edit &e : edits) {
+    code.append(original.data() + copied, e.offset - copied);
+    code += e.replacement;
+    copied = e.offset + e.length;
+  }
+  code.append(original.data() + copied, original.size() - copied);
+  return code;
+}
+
+::std::string MutantStorage::getMutantDirectory(IdType id) const {
+  return this->outputDirectory + ::std::to_string(id) + chimera::fs::pathSep;
+}
+
+bool FileMutantStorage::store(IdType id, ::llvm::StringRef code) {
+  ::std::string mutantPath = this->getMutantDirectory(id);
+  ::std::string filePath = mutantPath + this->filename;
+  if (this->compress) {
+    filePath += ".gz";
+  }
+  ChimeraLogger::verbose("[" + std::to_string(id) + "] Saving mutant in " +
+                         filePath);
+
+  // Create folder for this mutant
+  chimera::fs::createDirectories(mutantPath);
+  if (this->compress) {
+    if (!compression::writeGzipFile(filePath, code)) {
+      ChimeraLogger::error("An error occurred writing " + filePath);
+      return false;
+    }
+    return true;
+  }
+
+  if (!this->original.empty()) {
+    return this->writeSlices_(filePath, computeEdits(this->original, code));
+  }
+
+  // Save mutant on file
+  ::std::error_code fileError;
+  ::llvm::raw_fd_ostream file(filePath, fileError, ::llvm::sys::fs::F_Text);
+  if (fileError) {
+    ChimeraLogger::error("An error occurred during the file opening: " +
+                         fileError.message());
+    return false;
+  }
+  file << code;
+  file.close();
+  return true;
+}
+
+FileMutantStorage::~FileMutantStorage() {
+#ifdef LLVM_ON_UNIX
+  if (this->originalFD >= 0) {
+    ::close(this->originalFD);
+  }
+#endif
+}
+
+void FileMutantStorage::setOriginal(::std::string original,
+                                    const ::std::string &originalPath) {
+  if (this->compress) {
+    return;
+  }
+  this->original = ::std::move(original);
+#ifdef LLVM_ON_UNIX
+  // The in-kernel copy reads the target, it must be the parsed one
+  if (this->original.size() >= minCopySpan) {
+    this->originalFD = ::open(originalPath.c_str(), O_RDONLY);
+    struct stat status;
+    if (this->originalFD >= 0 &&
+        (::fstat(this->originalFD, &status) != 0 ||
+         ::std::size_t(status.st_size) != this->original.size())) {
+      ::close(this->originalFD);
+      this->originalFD = -1;
+    }
+  }
+#endif
+}
+
+bool FileMutantStorage::writeSlices_(const ::std::string &filePath,
+                                     const EditList &edits) {
+#ifdef LLVM_ON_UNIX
+  int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    ChimeraLogger::error("An error occurred during the file opening: " +
+                         ::std::string(::std::strerror(errno)));
+    return false;
+  }
+  // The slices written from memory, since the last in-kernel copy
+  ::std::vector<struct iovec> buffers;
+  auto addSlice = [&buffers](const char *data, ::std::size_t size) {
+    if (size != 0) {
+      buffers.push_back(iovec{const_cast<char *>(data), size});
+    }
+  };
+  bool ok = true;
+  ::std::size_t copied = 0;
+  for (::std::size_t i = 0; ok && i <= edits.size(); ++i) {
+    // The untouched span before the edit, or the last one
+    ::std::size_t end = i < edits.size() ? edits[i].offset
+                                         : this->original.size();
+    ::std::size_t span = end - copied;
+    if (this->originalFD >= 0 && this->copyFileRange && span >= minCopySpan) {
+      ok = writeAll(fd, buffers);
+      buffers.clear();
+      if (ok && !copyRange(this->originalFD, copied, span, fd,
+                           this->copyFileRange)) {
+        // Write it from memory
+        ok = !this->copyFileRange;
+        addSlice(this->original.data() + copied, span);
+      }
+    } else {
+      addSlice(this->original.data() + copied, span);
+    }
+    if (i < edits.size()) {
+      addSlice(edits[i].replacement.data(), edits[i].replacement.size());
+      copied = edits[i].offset + edits[i].length;
+    }
+  }
+  ok = ok && writeAll(fd, buffers);
+  ok = ::close(fd) == 0 && ok;
+  if (!ok) {
+    ChimeraLogger::error("An error occurred writing " + filePath);
+  }
+  return ok;
+#else
+  ::std::error_code fileError;
+  ::llvm::raw_fd_ostream file(filePath, fileError, ::llvm::sys::fs::F_None);
+  if (fileError) {
+    ChimeraLogger::error("An error occurred during the file opening: " +
+                         fileError.message());
+    return false;
+  }
+  file << applyEdits(this->original, edits);
+  return true;
+#endif
+}
+
+PatchMutantStorage::PatchMutantStorage(::std::string outputDirectory,
+                                       ::std::string filename,
+                                       ::std::string original)
+    : MutantStorage(::std::move(outputDirectory), ::std::move(filename)),
+      original(::std::move(original)) {
+  // The original, as reference for the edits
+  ::std::string originalDir =
+      this->outputDirectory + originalDirName + chimera::fs::pathSep;
+  chimera::fs::createDirectories(originalDir);
+  ::std::ofstream originalStream(originalDir + this->filename,
+                                 ::std::ofstream::binary);
+  originalStream << this->original;
+  if (!originalStream) {
+    ChimeraLogger::error("Couldn't write the original in " + originalDir);
+  }
+
+  this->patchStream.open(this->outputDirectory + patchFileName,
+                         ::std::ofstream::binary);
+  this->patchStream << patchHeader << "\n";
+  if (!this->patchStream) {
+    ChimeraLogger::error("Couldn't open the patch file in " +
+                         this->outputDirectory);
+  }
+}
+
+bool PatchMutantStorage::store(IdType id, ::llvm::StringRef code) {
+  EditList edits = computeEdits(this->original, code);
+  ChimeraLogger::verbose("[" + std::to_string(id) + "] Saving mutant as " +
+                         ::std::to_string(edits.size()) + " edits");
+  this->patchStream << "@" << id << " " << edits.size() << "\n";
+  for (const Edit &e : edits) {
+    this->patchStream << e.offset << " " << e.length << " "
+                      << e.replacement.size() << "\n"
+                      << e.replacement << "\n";
+  }
+  if (!this->patchStream) {
+    ChimeraLogger::error("An error occurred writing the patch file");
+    return false;
+  }
+  return true;
+}
+
+bool PatchMutantReader::open(const ::std::string &outputDirectory,
+                             const ::std::string &filename) {
+  this->index.clear();
+  auto buffer = ::llvm::MemoryBuffer::getFile(
+      outputDirectory + PatchMutantStorage::originalDirName +
+      chimera::fs::pathSep + filename);
+  if (!buffer) {
+    return false;
+  }
+  this->original = (*buffer)->getBuffer().str();
+
+  this->patchStream.close();
+  this->patchStream.clear();
+  this->patchStream.open(outputDirectory + PatchMutantStorage::patchFileName,
+                         ::std::ifstream::binary);
+  ::std::string line;
+  if (!::std::getline(this->patchStream, line) || line != patchHeader) {
+    return false;
+  }
+  // Index the mutants, skipping the replacements
+  while (true) {
+    ::std::streamoff position = this->patchStream.tellg();
+    char at;
+    IdType id;
+    ::std::size_t count;
+    if (!(this->patchStream >> at >> id >> count) || at != '@') {
+      break;
+    }
+    this->index[id] = position;
+    for (::std::size_t i = 0; i < count; ++i) {
+      ::std::size_t offset, length, size;
+      this->patchStream >> offset >> length >> size;
+      this->patchStream.ignore(1);
+      this->patchStream.seekg(size + 1, ::std::ios_base::cur);
+    }
+    if (!this->patchStream) {
+      return false;
+    }
+  }
+  this->patchStream.clear();
+  return true;
+}
+
+bool PatchMutantReader::readEdits(IdType id, EditList &edits) {
+  auto it = this->index.find(id);
+  if (it == this->index.end()) {
+    return false;
+  }
+  this->patchStream.clear();
+  this->patchStream.seekg(it->second);
+  char at;
+  ::std::size_t count;
+  this->patchStream >> at >> id >> count;
+  edits.assign(count, Edit());
+  for (Edit &e : edits) {
+    ::std::size_t size;
+    this->patchStream >> e.offset >> e.length >> size;
+    this->patchStream.ignore(1);
+    e.replacement.resize(size);
+    this->patchStream.read(&e.replacement[0], size);
+    this->patchStream.ignore(1);
+  }
+  return bool(this->patchStream);
+}
+
+bool PatchMutantReader::read(IdType id, ::std::string &code) {
+  EditList edits;
+  if (!this->readEdits(id, edits)) {
+    return false;
+  }
+  code = applyEdits(this->original, edits);
+  return true;
+}
+
+::std::vector<IdType> PatchMutantReader::getIds() const {
+  ::std::vector<IdType> ids;
+  for (const auto &entry : this->index) {
+    ids.push_back(entry.first);
+  }
+  return ids;
+}
+
+ArchiveWriter::ArchiveWriter(const ::std::string &archivePath, bool compress)
+    : compress(compress) {
+  ::std::error_code fileError;
+  this->archive.reset(new ::llvm::raw_fd_ostream(archivePath, fileError,
+                                                 ::llvm::sys::fs::F_None));
+  if (fileError) {
+    ChimeraLogger::error("Couldn't open the archive " + archivePath + ": " +
+                         fileError.message());
+    this->archive.reset();
+    return;
+  }
+  this->archive->write(compress ? compressedArchiveMagic : archiveMagic,
+                       sizeof(archiveMagic));
+  writeU64(*this->archive, archiveVersion);
+}
+
+ArchiveWriter::~ArchiveWriter() {
+  if (!this->archive) {
+    return;
+  }
+  // The index follows the last record, after its magic number that stops the
+  // scan of the records
+  this->archive->write(indexMagic, sizeof(indexMagic));
+  ::std::uint64_t indexOffset = this->archive->tell();
+  ::std::stable_sort(this->index.begin(), this->index.end(),
+                     [](const ArchiveEntry &a, const ArchiveEntry &b) {
+                       return a.id < b.id;
+                     });
+  for (const ArchiveEntry &e : this->index) {
+    writeU64(*this->archive, e.id);
+    writeU64(*this->archive, e.offset);
+    writeU64(*this->archive, e.size);
+  }
+  writeU64(*this->archive, indexOffset);
+  writeU64(*this->archive, this->index.size());
+  this->archive->write(indexMagic, sizeof(indexMagic));
+  this->archive->close();
+  if (this->archive->has_error()) {
+    ChimeraLogger::error("An error occurred writing the archive index");
+    this->archive->clear_error();
+  }
+}
+
+bool ArchiveWriter::append(IdType id, ::llvm::StringRef data) {
+  if (!this->archive) {
+    return false;
+  }
+  ::std::string compressed;
+  if (this->compress) {
+    // Each record is a stream on its own, readable without the others
+    if (!compression::compress(data, compressed)) {
+      ChimeraLogger::error("[" + std::to_string(id) +
+                           "] Couldn't compress the record");
+      return false;
+    }
+  }
+  ::std::uint64_t size = this->compress ? 8 + compressed.size() : data.size();
+  writeU64(*this->archive, id);
+  writeU64(*this->archive, size);
+  this->index.push_back(ArchiveEntry{id, this->archive->tell(), size});
+  if (this->compress) {
+    writeU64(*this->archive, data.size());
+    *this->archive << compressed;
+  } else {
+    *this->archive << data;
+  }
+  if (this->archive->has_error()) {
+    ChimeraLogger::error("An error occurred writing the archive");
+    return false;
+  }
+  return true;
+}
+
+ArchiveMutantStorage::ArchiveMutantStorage(::std::string outputDirectory,
+                                           ::std::string filename,
+                                           bool compress)
+    : MutantStorage(::std::move(outputDirectory), ::std::move(filename)),
+      archive(this->outputDirectory + archiveFileName, compress) {}
+
+bool ArchiveMutantStorage::store(IdType id, ::llvm::StringRef code) {
+  ChimeraLogger::verbose("[" + std::to_string(id) +
+                         "] Saving mutant in the archive");
+  return this->archive.append(id, code);
+}
+
+bool ArchiveMutantReader::open(const ::std::string &archivePath) {
+  this->index.clear();
+  // Without the null terminator the archive is mapped, not copied
+  auto buffer = ::llvm::MemoryBuffer::getFile(archivePath, -1, false);
+  if (!buffer) {
+    return false;
+  }
+  this->buffer = ::std::move(*buffer);
+  const char *data = this->buffer->getBufferStart();
+  ::std::uint64_t size = this->buffer->getBufferSize();
+  if (size < archiveHeaderSize || readU64(data + 8) != archiveVersion) {
+    return false;
+  }
+  if (::std::memcmp(data, compressedArchiveMagic,
+                    sizeof(compressedArchiveMagic)) == 0) {
+    this->compressed = true;
+  } else if (::std::memcmp(data, archiveMagic, sizeof(archiveMagic)) == 0) {
+    this->compressed = false;
+  } else {
+    return false;
+  }
+
+  // Read the index, if complete
+  if (size >= archiveHeaderSize + trailerSize &&
+      ::std::memcmp(data + size - 8, indexMagic, sizeof(indexMagic)) == 0) {
+    ::std::uint64_t indexOffset = readU64(data + size - trailerSize);
+    ::std::uint64_t entries = readU64(data + size - trailerSize + 8);
+    ::std::uint64_t indexEnd = size - trailerSize;
+    if (indexOffset >= archiveHeaderSize + 8 && indexOffset <= indexEnd &&
+        (indexEnd - indexOffset) % indexEntrySize == 0 &&
+        (indexEnd - indexOffset) / indexEntrySize == entries) {
+      this->index.reserve(entries);
+      for (const char *e = data + indexOffset; e < data + indexEnd;
+           e += indexEntrySize) {
+        ArchiveEntry entry{IdType(readU64(e)), readU64(e + 8),
+                           readU64(e + 16)};
+        if (entry.offset > indexOffset ||
+            entry.size > indexOffset - entry.offset) {
+          return false;
+        }
+        this->index.push_back(entry);
+      }
+      return true;
+    }
+  }
+  return this->scan_();
+}
+
+bool ArchiveMutantReader::scan_() {
+  const char *data = this->buffer->getBufferStart();
+  ::std::uint64_t size = this->buffer->getBufferSize();
+  ::std::uint64_t offset = archiveHeaderSize;
+  while (size - offset >= recordHeaderSize &&
+         ::std::memcmp(data + offset, indexMagic, sizeof(indexMagic)) != 0) {
+    ::std::uint64_t codeSize = readU64(data + offset + 8);
+    if (codeSize > size - offset - recordHeaderSize) {
+      // A truncated record
+      break;
+    }
+    this->index.push_back(ArchiveEntry{IdType(readU64(data + offset)),
+                                       offset + recordHeaderSize, codeSize});
+    offset += recordHeaderSize + codeSize;
+  }
+  ::std::sort(this->index.begin(), this->index.end(),
+              [](const ArchiveEntry &a, const ArchiveEntry &b) {
+                return a.id < b.id;
+              });
+  return true;
+}
+
+bool ArchiveMutantReader::read(IdType id, ::std::string &code) const {
+  ::llvm::StringRef data;
+  if (!this->readStored(id, data)) {
+    return false;
+  }
+  if (!this->compressed) {
+    code = data.str();
+    return true;
+  }
+  if (data.size() < 8) {
+    return false;
+  }
+  // zlib doesn't compress more than about 1000:1, a larger size is corrupt
+  ::std::uint64_t size = readU64(data.data());
+  return size / 1024 <= data.size() &&
+         compression::uncompress(data.substr(8), size, code);
+}
+
+bool ArchiveMutantReader::readStored(IdType id,
+                                     ::llvm::StringRef &data) const {
+  if (this->index.empty()) {
+    return false;
+  }
+  // The ids are usually consecutive, so the position is known
+  ::std::size_t position = id - this->index.front().id;
+  const ArchiveEntry *entry = nullptr;
+  if (id >= this->index.front().id && position < this->index.size() &&
+      this->index[position].id == id) {
+    entry = &this->index[position];
+  } else {
+    auto it = ::std::lower_bound(
+        this->index.begin(), this->index.end(), id,
+        [](const ArchiveEntry &e, IdType id) { return e.id < id; });
+    if (it == this->index.end() || it->id != id) {
+      return false;
+    }
+    entry = &*it;
+  }
+  data = ::llvm::StringRef(this->buffer->getBufferStart() + entry->offset,
+                           entry->size);
+  return true;
+}
+
+::std::vector<IdType> ArchiveMutantReader::getIds() const {
+  ::std::vector<IdType> ids;
+  for (const ArchiveEntry &entry : this->index) {
+    ids.push_back(entry.id);
+  }
+  return ids;
+}
+
+bool MutantExtractor::open(const ::std::string &outputDirectory,
+                           const ::std::string &filename) {
+  this->outputDirectory = outputDirectory;
+  this->filename = filename;
+  if (::llvm::sys::fs::exists(outputDirectory +
+                              ArchiveMutantStorage::archiveFileName)) {
+    this->format = ArchiveStorage;
+    return this->archiveReader.open(outputDirectory +
+                                    ArchiveMutantStorage::archiveFileName);
+  }
+  if (::llvm::sys::fs::exists(outputDirectory +
+                              PatchMutantStorage::patchFileName)) {
+    this->format = PatchStorage;
+    return this->patchReader.open(outputDirectory, filename);
+  }
+  // The copies are read one by one
+  this->format = FilesStorage;
+  return ::llvm::sys::fs::is_directory(outputDirectory);
+}
+
+bool MutantExtractor::read(IdType id, ::std::string &code) {
+  switch (this->format) {
+  case ArchiveStorage:
+    return this->archiveReader.read(id, code);
+  case PatchStorage:
+    return this->patchReader.read(id, code);
+  default:
+    break;
+  }
+  ::std::string filePath =
+      this->outputDirectory + ::std::to_string(id) + chimera::fs::pathSep +
+      this->filename;
+  if (::llvm::sys::fs::exists(filePath + ".gz")) {
+    return compression::readGzipFile(filePath + ".gz", code);
+  }
+  auto buffer = ::llvm::MemoryBuffer::getFile(filePath);
+  if (!buffer) {
+    return false;
+  }
+  code = (*buffer)->getBuffer().str();
+  return true;
+}
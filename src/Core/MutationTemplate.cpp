@@ -28,12 +28,15 @@
 #include "Core/MutationTemplate.h"
 #include "Tooling/FrontendActions.h"
 #include "Tooling/CompilationDatabaseUtils.h"
+#include "Tooling/DeferredMutant.h"
 
 #include "clang/Rewrite/Core/Rewriter.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include <algorithm>
+#include <functional>
 
 using namespace clang;
 using namespace clang::tooling;
@@ -50,6 +53,45 @@ static mutant::IdType mutantCounterInitial = 1;
 
 // FIXME: When a function name is not found -> LLVM IO ERROR.
 
+/// @brief Locate a function that the batches can clone
+/// @details Only the non-template functions at file scope, not methods, with
+///          the name and the body written in the target. Not the constexpr
+///          ones nor the ones with a deduced return type: a mutated clone
+///          compiles on its own, the mutant can break their callers.
+/// @param f The function
+/// @param sm The source manager of the target
+/// @param site The offsets of the function in the target
+/// @return If the function can be cloned
+static bool getCloneSite(const FunctionDecl *f, const SourceManager &sm,
+                         MutantBatch::CloneSite &site) {
+  if (f == nullptr || !f->getDeclContext()->isTranslationUnit() ||
+      isa<CXXMethodDecl>(f) ||
+      f->getTemplatedKind() != FunctionDecl::TK_NonTemplate ||
+      !f->getDeclName().isIdentifier() ||
+      !f->doesThisDeclarationHaveABody() || f->isConstexpr() ||
+      f->getReturnType()->getContainedAutoType() != nullptr) {
+    return false;
+  }
+  const Stmt *body = f->getBody();
+  SourceLocation locations[] = {f->getSourceRange().getBegin(),
+                                body->getLocStart(), body->getLocEnd(),
+                                f->getLocation()};
+  for (const SourceLocation &l : locations) {
+    if (l.isInvalid() || !l.isFileID() || !sm.isInMainFile(l)) {
+      return false;
+    }
+  }
+  site.declBegin = sm.getFileOffset(locations[0]);
+  site.bodyBegin = sm.getFileOffset(locations[1]);
+  site.declEnd = sm.getFileOffset(locations[2]) + 1; // Past the '}'
+  site.nameBegin = sm.getFileOffset(locations[3]);
+  site.nameEnd = site.nameBegin + f->getName().size();
+  // The name must be spelled as is
+  return site.declBegin <= site.nameBegin && site.nameEnd <= site.bodyBegin &&
+         sm.getBufferData(sm.getMainFileID())
+                 .substr(site.nameBegin, f->getName().size()) == f->getName();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// @brief    This class manages the creation and deletion of rewriter objects
 /// @details  It works with a reservation mechanism:
@@ -156,7 +198,28 @@ private:
   ::std::pair<IdType, SlotType> localSlot; // Local slot
 };
 
-static SlotManager<mutant::IdType, Rewriter> rwManager;
+/// @brief A HOM mutant whose check is deferred to the end of the translation
+/// unit, shared by the mutators of its operator
+struct DeferredHom {
+  ::std::unique_ptr<DeferredMutant> mutant; ///< The accumulated mutations
+  /// Commit of each mutation, it receives if the mutation is kept, the final
+  /// code and if the mutant has to be saved
+  ::std::vector<::std::function<void(bool, const ::std::string &, bool)>>
+      commits;
+};
+
+/// @brief The state of the mutant ids of an analysis
+struct chimera::MutationTemplate::MutantSlots {
+  /// Rewriter of each mutant, reserved for the HOM ones
+  SlotManager<mutant::IdType, Rewriter> rwManager;
+  /// Mutant id reserved for each HOM operator
+  SlotManager<m_operator::IdType, mutant::IdType> idManager;
+  /// HOM mutants whose check is deferred
+  ::std::map<mutant::IdType, DeferredHom> deferredHoms;
+  /// Number of the mutations applied, it tags their log lines until the id
+  /// is assigned at the commit
+  ::std::size_t applied = 0;
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 /// @brief MatchCallback child : The callback called for the mutator's matchers
@@ -171,7 +234,7 @@ public:
                          std::string tempDirName = "temp")
       : MatchCallback(), mutationTemplate(mutTempl), mutator(mutator),
         sourceManager(nullptr), context(nullptr), localMutantId(staticId),
-        tempDirName(tempDirName) {}
+        deferCheck(staticId != 0), tempDirName(tempDirName) {}
 
   /// @brief Set the local pointer to the source manager
   /// @param manager A pointer to the source manager
@@ -214,8 +277,8 @@ public:
       id = this->mutationTemplate.mutantCounter;
     }
     bool wasReserved;
-    return rwManager.getSlot(id, wasReserved, *(this->sourceManager),
-                             this->context->getLangOpts());
+    return this->mutationTemplate.getMutantSlots().rwManager.getSlot(
+        id, wasReserved, *(this->sourceManager), this->context->getLangOpts());
   }
 
   /// @brief Called when a mutant has been created, it finalizes the used
@@ -231,7 +294,7 @@ public:
         // If the localMutantId was 0, it has to be set and ...
         this->localMutantId = this->mutationTemplate.mutantCounter++;
         // ... the rewriter reserved
-        rwManager.reserveLocalSlot();
+        this->mutationTemplate.getMutantSlots().rwManager.reserveLocalSlot();
       }
     } else
       // FOM, increment and do nothing
@@ -255,19 +318,50 @@ public:
 
     // Loop on mutator types
     for (MutatorType i = 0; i < this->mutator->getTypes(); ++i) {
+      // The first order mutations of the other shards aren't even applied
+      if (!this->mutator->isHom() &&
+          this->mutationTemplate.getShardCount() > 1) {
+        ::std::string functionName;
+        unsigned line = 0, column = 0;
+        if (nodeIsValid) {
+          functionName = Result.Nodes.getNodeAs<FunctionDecl>("functionDecl")
+                             ->getNameAsString();
+          this->getLineColumn(matchedNode.getSourceRange().getBegin(), line,
+                              column);
+        }
+        if (!this->mutationTemplate.isInShard(functionName, line, column,
+                                              this->mutator->getIdentifier(),
+                                              i)) {
+          continue;
+        }
+      }
+      // A HOM mutator of a FOM operator reserves its rewriter when its first
+      // mutation is committed, the next ones build on it: the mutants in
+      // validation are committed first, then its mutations synchronously
+      bool synchronous = this->mutator->isHom() && !this->deferCheck;
+      if (synchronous &&
+          this->mutationTemplate.getValidationPool() != nullptr) {
+        this->mutationTemplate.closeBatch();
+        this->mutationTemplate.getValidationPool()->drain();
+      }
       // Per mutation type actions:
       // * Set local mutantId and retrieve a rewriter
       Rewriter &localRw = this->initializeMutant(mutantId);
+      // The id is known only at the commit, the log tags the mutation
+      ::std::string tag =
+          "[#" +
+          ::std::to_string(++this->mutationTemplate.getMutantSlots().applied) +
+          "]";
 
       // Verbose messages
       if (nodeIsValid) {
         ChimeraLogger::verbose(
-            "[" + std::to_string(mutantId) + "] Applying mutation in " +
+            tag + " Applying mutation in " +
             matchedNode.getSourceRange().getBegin().printToString(
                 *(this->sourceManager)));
       } else {
-        ChimeraLogger::verbose("[" + std::to_string(mutantId) +
-                               "] Applying mutation in <invalid>. Report for "
+        ChimeraLogger::verbose(tag +
+                               " Applying mutation in <invalid>. Report for "
                                "this mutant will not be generated");
       }
 
@@ -279,89 +373,386 @@ public:
       if (localRw.getRewriteBufferFor(localRw.getSourceMgr().getMainFileID()) !=
           nullptr) {
         // The source file has been somehow modified, continue
-        // Check if the mutant is valid
-        ChimeraLogger::verboseAndIncr("[" + std::to_string(mutantId) +
-                                      "][ RUN  ] Checking mutant");
-
-        if (this->checkMutant(localRw)) {
-          ChimeraLogger::verbosePreDecr("[" + std::to_string(mutantId) +
-                                        "][ PASS ] Checking mutant");
-
-          // The mutant is valid, continue
-          // Save the report if the matched node is valid
-          if (nodeIsValid) {
-            this->createReportEntry(
-                mutantId, Result.Nodes.getNodeAs<FunctionDecl>("functionDecl")
-                              ->getNameAsString(),
-                matchedNode.getSourceRange().getBegin(),
-                this->mutator->getIdentifier(), i);
+        // Render the mutant: the rewriter is reused by the next mutations,
+        // before the check of this one is committed
+        ::std::string code;
+        ::llvm::raw_string_ostream codeStream(code);
+        localRw.getEditBuffer(localRw.getSourceMgr().getMainFileID())
+            .write(codeStream);
+        codeStream.flush();
+
+        // The matched nodes don't outlive the match, keep what the report
+        // needs
+        ::std::string functionName;
+        SourceLocation location;
+        if (nodeIsValid) {
+          functionName = Result.Nodes.getNodeAs<FunctionDecl>("functionDecl")
+                             ->getNameAsString();
+          location = matchedNode.getSourceRange().getBegin();
+        }
+
+        if (this->deferCheck) {
+          // The HOM mutant is checked as a whole at the end of the
+          // translation unit, the mutations that break it are dropped then
+          DeferredHom &hom =
+              this->mutationTemplate.getMutantSlots().deferredHoms[mutantId];
+          if (!hom.mutant) {
+            hom.mutant.reset(new DeferredMutant(
+                this->sourceManager
+                    ->getBufferData(this->sourceManager->getMainFileID())
+                    .str()));
           }
+          hom.mutant->addStep(code);
+          hom.commits.push_back(
+              [this, nodeIsValid, functionName, location, i,
+               tag](bool valid, const ::std::string &code, bool save) {
+                this->commitMutant(valid, code, nodeIsValid, functionName,
+                                   location, i, tag, save);
+              });
+          ChimeraLogger::verbose(tag + " Check deferred to the end of the "
+                                       "translation unit");
+          continue;
+        }
+
+        ValidationStatistics &statistics =
+            this->mutationTemplate.getValidationStatistics();
+        // Different mutations can produce the same first order mutant, only
+        // the first occurrence is checked and saved
+        ValidationCache::KeyType key;
+        bool duplicate = false;
+        if (!this->mutator->isHom() &&
+            this->mutationTemplate.isDeduplicate()) {
+          key = ValidationCache::computeKey(
+              code, this->mutationTemplate.getCompileCommand(),
+              this->mutator->getAdditionalCompileCommands());
+          duplicate = !this->mutationTemplate.getFirstOccurrences()
+                           .insert(::std::make_pair(key, 0))
+                           .second;
+        }
 
-          // Save the mutant to file if this feature is enabled
-          if (this->mutationTemplate.isGenerateMutants()) {
-            this->saveMutant(mutantId, localRw);
+        ValidationPool::CommitCallback commit;
+        if (duplicate) {
+          commit = [this, key, nodeIsValid, functionName, location, i,
+                    tag](bool, const ::std::string &) {
+            this->commitAlias(key, nodeIsValid, functionName, location, i,
+                              tag);
+          };
+        } else {
+          commit = [this, key, nodeIsValid, functionName, location, i,
+                    tag](bool valid, const ::std::string &code) {
+            mutant::IdType id = this->commitMutant(
+                valid, code, nodeIsValid, functionName, location, i, tag);
+            if (!key.empty()) {
+              this->mutationTemplate.getFirstOccurrences()[key] = id;
+            }
+          };
+        }
+
+        // Check if the mutant is valid
+        ChimeraLogger::verbose(tag + "[ RUN  ] Checking mutant");
+        ValidationPool *pool =
+            synchronous ? nullptr : this->mutationTemplate.getValidationPool();
+        // The mutator can guarantee the mutation keeps the code well formed
+        bool syntaxSafe = !duplicate && !this->mutationTemplate.isParanoid() &&
+                          this->mutator->isSyntaxSafe(Result, i);
+        // Decide the first order operator replacements on the AST of the
+        // original, without a reparse
+        opvalidator::Verdict astVerdict = opvalidator::Unknown;
+        const BinaryOperator *replacedOp = nullptr;
+        BinaryOperatorKind replacement;
+        if (!duplicate && !syntaxSafe && !this->mutator->isHom() &&
+            this->mutationTemplate.isUseOperatorValidator() &&
+            !this->mutationTemplate.isParanoid() &&
+            this->mutator->getOperatorReplacement(Result, i, replacedOp,
+                                                  replacement) &&
+            opvalidator::acceptsCommandLine(
+                this->mutationTemplate.getCompileCommand().CommandLine) &&
+            opvalidator::acceptsCommandLine(
+                this->mutator->getAdditionalCompileCommands())) {
+          astVerdict =
+              opvalidator::check(replacedOp, replacement, *Result.Context);
+        }
+        // Reject the trivially broken mutants without the frontend
+        prefilter::Verdict verdict = prefilter::Plausible;
+        if (!duplicate && !syntaxSafe && astVerdict == opvalidator::Unknown &&
+            this->mutationTemplate.isUsePrefilter()) {
+          verdict = prefilter::check(
+              this->sourceManager->getBufferData(
+                  this->sourceManager->getMainFileID()),
+              code);
+        }
+        MutantBatch *batch =
+            synchronous ? nullptr : this->mutationTemplate.getOpenBatch();
+        if (duplicate) {
+          statistics.duplicates++;
+          ChimeraLogger::verbose(tag +
+                                 " Equal to a previous mutant, check skipped");
+        } else if (syntaxSafe) {
+          statistics.syntaxSafe++;
+          ChimeraLogger::verbose(tag + " Syntax safe mutation, check skipped");
+        } else if (astVerdict != opvalidator::Unknown) {
+          statistics.astDecided++;
+          ChimeraLogger::verbose(tag + " Decided on the AST: " +
+                                 opvalidator::getVerdictName(astVerdict));
+        } else if (verdict != prefilter::Plausible) {
+          statistics.prefilterRejected[verdict]++;
+          ChimeraLogger::verbose(tag + " Rejected by the prefilter: " +
+                                 prefilter::getVerdictName(verdict));
+        }
+        if (duplicate || syntaxSafe || astVerdict != opvalidator::Unknown ||
+            verdict != prefilter::Plausible) {
+          // Already resolved, an alias takes the verdict of the first
+          // occurrence when committed
+          bool valid = syntaxSafe || astVerdict == opvalidator::Valid;
+          if (batch != nullptr) {
+            // Keep the order of the batched mutants
+            pool->submitToGroup(::std::move(code), commit);
+            batch->addResolved(valid);
+          } else if (pool != nullptr) {
+            // Committed in order with the mutants in validation
+            pool->submitResolved(valid, ::std::move(code), commit);
           } else {
-            ChimeraLogger::verbose("[" + std::to_string(mutantId) +
-                                   "] Saving disabled");
+            commit(valid, code);
           }
-          // Increment mutantCounter if the mutator is not an HOM
-          this->finalizeMutant();
         } else {
-          // The mutant is invalid
-          ChimeraLogger::verbosePreDecr("[" + std::to_string(mutantId) +
-                                        "][ FAIL ] Checking mutant");
-#ifdef _CHIMERA_DEBUG_
-          // DEBUG
-          rw.getEditBuffer(rw.getSourceMgr().getMainFileID())
-              .write(llvm::outs());
-#endif
+          statistics.checked++;
+          if (batch != nullptr) {
+            // The first order mutants of a function body can be checked
+            // together, as clones of the function
+            MutantBatch::CloneSite site;
+            bool cloneable =
+                !this->mutator->isHom() &&
+                getCloneSite(
+                    Result.Nodes.getNodeAs<FunctionDecl>("functionDecl"),
+                    *this->sourceManager, site);
+            batch->add(pool->submitToGroup(::std::move(code), commit),
+                       cloneable ? &site : nullptr,
+                       this->mutator->getAdditionalCompileCommands());
+          } else if (pool != nullptr) {
+            // The result is committed later, in submission order
+            pool->submit(::std::move(code),
+                         this->mutator->getAdditionalCompileCommands(),
+                         commit);
+          } else {
+            commit(this->checkMutant(code), code);
+          }
+        }
+        if (batch != nullptr && batch->isFull()) {
+          this->mutationTemplate.closeBatch();
         }
       } else {
-        ChimeraLogger::verbose("[" + std::to_string(mutantId) +
-                               "] Application didn't produce changes");
+        ChimeraLogger::verbose(tag + " Application didn't produce changes");
       }
       //      this->deleteLocalRewriter();  // Delete the rewriter
     }
   }
 
-  /// @brief Save a mutant given an unique id and the Rewriter that contains the
-  /// sourceBuffer
-  /// @param id Mutant unique id
-  /// @param rewriter Rewriter object with RewriteBuffer that contains the
-  /// source modification
-  /// @return If the Mutant is correctly saved
-  bool saveMutant(mutant::IdType id, Rewriter &rewriter) {
-    std::string filename(this->mutationTemplate.getTargetFilename().data());
-    std::string mutantPath = this->mutationTemplate.getTargetOutputDirectory() +
-                             std::to_string(id) + chimera::fs::pathSep;
-    std::string filePath = mutantPath + filename;
-    ChimeraLogger::verbose("[" + std::to_string(id) + "] Saving mutant in " +
-                           clang::tooling::getAbsolutePath(filePath));
-
-    // Create folder for this mutant
-    chimera::fs::createDirectories(mutantPath);
-
-    // Save mutant on file
-    // Create the file stream
-    ::std::error_code fileError;
-    llvm::raw_fd_ostream file(filePath.c_str(), fileError,
-                              llvm::sys::fs::F_Text);
-    if (!file.has_error()) {
-      rewriter.getEditBuffer(rewriter.getSourceMgr().getMainFileID())
-          .write(file);
-    } else {
-      ChimeraLogger::error("An error occurred during the file opening: " +
-                           fileError.message());
-      return false;
+  /// @brief Commit the result of the check of a mutant: report and/or save
+  /// it if valid.
+  /// @details The mutant id is assigned here, so it depends only on the order
+  ///          of the commits, that is the order of the mutations.
+  /// @param valid If the mutant passed the check
+  /// @param code The mutant
+  /// @param nodeIsValid If the matched node was valid
+  /// @param functionName The function that contains the mutation
+  /// @param location The location of the matched node
+  /// @param type The mutator type applied
+  /// @param tag The tag of the mutation in the log
+  /// @param save If the mutant is saved, when enabled
+  /// @return The mutant id, 0 if invalid
+  mutant::IdType commitMutant(bool valid, const ::std::string &code,
+                              bool nodeIsValid,
+                              const ::std::string &functionName,
+                              const SourceLocation &location, MutatorType type,
+                              const ::std::string &tag, bool save = true) {
+    mutant::IdType internalId = this->localMutantId;
+    if (internalId == 0) {
+      // As for the FOM mutator
+      internalId = this->mutationTemplate.mutantCounter;
     }
-    file.close(); // Close the file stream
-    return true;
+    mutant::IdType mutantId = internalId;
+    if (valid) {
+      unsigned line, column;
+      this->getLineColumn(location, line, column);
+      mutantId = this->mutationTemplate.getMutantId(
+          internalId, functionName, line, column,
+          this->mutator->getIdentifier(), type);
+      ChimeraLogger::verbose("[" + std::to_string(mutantId) + "]" + tag +
+                             "[ PASS ] Checking mutant");
+
+      // The mutant is valid, continue
+      // Save the report if the matched node is valid
+      if (nodeIsValid) {
+        this->createReportEntry(mutantId, functionName, location,
+                                this->mutator->getIdentifier(), type);
+      }
+
+      // Save the mutant to file if this feature is enabled
+      if (this->mutationTemplate.isGenerateMutants()) {
+        if (save) {
+          this->saveMutant(mutantId, code, functionName, location, type);
+        }
+      } else {
+        ChimeraLogger::verbose("[" + std::to_string(mutantId) +
+                               "] Saving disabled");
+      }
+      // Increment mutantCounter if the mutator is not an HOM
+      this->finalizeMutant();
+      return mutantId;
+    }
+    // The mutant is invalid
+    ChimeraLogger::verbose(tag + "[ FAIL ] Checking mutant");
+#ifdef _CHIMERA_DEBUG_
+    // DEBUG
+    llvm::outs() << code;
+#endif
+    return 0;
   }
 
-  /// @brief Check syntactically a mutant identified by id
+  /// @brief Commit a mutant equal to a previous one: if that is valid, report
+  /// the mutation with its id
+  /// @details The first occurrence is committed before, it has its id.
+  /// @param key The hash of the mutant code
+  /// @param tag The tag of the mutation in the log
+  void commitAlias(const ValidationCache::KeyType &key, bool nodeIsValid,
+                   const ::std::string &functionName,
+                   const SourceLocation &location, MutatorType type,
+                   const ::std::string &tag) {
+    mutant::IdType id = this->mutationTemplate.getFirstOccurrences()[key];
+    if (id == 0) {
+      ChimeraLogger::verbose(tag + " Equal to an invalid mutant, discarded");
+      return;
+    }
+    ChimeraLogger::verbose("[" + std::to_string(id) + "]" + tag +
+                           " Alias of the mutant");
+    if (nodeIsValid) {
+      this->createReportEntry(id, functionName, location,
+                              this->mutator->getIdentifier(), type);
+    }
+  }
+
+  /// @brief Check the deferred HOM mutant and commit its mutations
+  /// @details The first mutator of the operator reaching the end of the
+  ///          translation unit does it for all of them
+  void checkDeferredMutant() {
+    auto &deferredHoms = this->mutationTemplate.getMutantSlots().deferredHoms;
+    auto it = deferredHoms.find(this->localMutantId);
+    if (it == deferredHoms.end()) {
+      // Already checked, or without mutations
+      return;
+    }
+    DeferredHom hom = ::std::move(it->second);
+    deferredHoms.erase(it);
+
+    ::std::string id = ::std::to_string(this->localMutantId);
+    ChimeraLogger::verboseAndIncr(
+        "[" + id + "][ RUN  ] Checking the HOM mutant, " +
+        ::std::to_string(hom.mutant->getSteps()) + " mutations");
+    ValidationStatistics &statistics =
+        this->mutationTemplate.getValidationStatistics();
+    bool usePrefilter = this->mutationTemplate.isUsePrefilter();
+    ::llvm::StringRef original =
+        this->sourceManager->getBufferData(this->sourceManager->getMainFileID());
+    ::std::string code;
+    unsigned checks;
+    ::std::vector<bool> keep = hom.mutant->validate(
+        [this, &statistics, usePrefilter, original](const ::std::string &c) {
+          // Reject the trivially broken steps without the frontend
+          if (usePrefilter) {
+            prefilter::Verdict verdict = prefilter::check(original, c);
+            if (verdict != prefilter::Plausible) {
+              statistics.prefilterRejected[verdict]++;
+              return false;
+            }
+          }
+          statistics.checked++;
+          return this->checkMutant(c);
+        },
+        code, checks);
+    // The mutant is saved once, with its last mutation
+    ::std::size_t kept = ::std::count(keep.begin(), keep.end(), true);
+    ::std::size_t committed = 0;
+    for (::std::size_t i = 0; i < keep.size(); ++i) {
+      committed += keep[i];
+      hom.commits[i](keep[i], code, keep[i] && committed == kept);
+    }
+    ChimeraLogger::verbosePreDecr(
+        "[" + id + "][ DONE ] Checking the HOM mutant, " +
+        ::std::to_string(kept) + " mutations kept with " +
+        ::std::to_string(checks) + " checks");
+  }
+
+  /// @brief Get the spelling line and column of a location, 0 if invalid
+  void getLineColumn(const SourceLocation &l, unsigned &line,
+                     unsigned &column) const {
+    line = column = 0;
+    if (l.isValid()) {
+      FullSourceLoc fullLoc(l, *(this->sourceManager));
+      line = fullLoc.getSpellingLineNumber();
+      column = fullLoc.getSpellingColumnNumber();
+    }
+  }
+
+  /// @brief Pass a mutant, given an unique id and its code, to the sink
+  /// @details The write is queued, the errors are logged by the sink.
   /// @param id Mutant unique id
+  /// @param code The mutant
+  /// @param functionName The function that contains the mutation
+  /// @param location The location of the matched node
+  /// @param type The mutator type applied
+  void saveMutant(mutant::IdType id, const ::std::string &code,
+                  const ::std::string &functionName,
+                  const SourceLocation &location, MutatorType type) {
+    unsigned line, column;
+    this->getLineColumn(location, line, column);
+    ::std::string mutatorIdentifier = this->mutator->getIdentifier();
+    MutationTemplate *t = &this->mutationTemplate;
+    t->writeOutput([t, id, code, functionName, line, column,
+                    mutatorIdentifier, type]() {
+      mutant::MutantSink *sink = t->getMutantSink();
+      mutant::MutantInfo info{t->getTargetPath(), id, functionName, line,
+                              column, mutatorIdentifier, type};
+      // The edits are computed here, off the matching
+      mutant::EditList edits;
+      if (sink->wantsEdits()) {
+        edits = mutant::computeEdits(t->getTargetCode(), code);
+      }
+      sink->consume(info, edits, code);
+    });
+  }
+
+  /// @brief Check syntactically a mutant
+  /// @param code The mutant
   /// @return If the mutant passes the check
-  bool checkMutant(Rewriter &rw) {
+  bool checkMutant(::llvm::StringRef code) {
+    if (this->mutationTemplate.getValidationMode() == InMemoryValidation) {
+      // The code is overlaid on the target path, nothing is written on disk.
+      // The session consults the cache by itself.
+      ChimeraLogger::verbose("Running in-memory syntax check");
+      return this->mutationTemplate.getValidationSession().check(
+          code, this->mutator->getAdditionalCompileCommands());
+    }
+    ValidationCache *cache = this->mutationTemplate.getValidationCache();
+    if (cache == nullptr) {
+      return this->checkMutantOnDisk(code);
+    }
+    // Same key of the in-memory validation
+    ValidationCache::KeyType key = ValidationCache::computeKey(
+        code,
+        this->mutationTemplate.getValidationSession().getCompileCommand(),
+        this->mutator->getAdditionalCompileCommands());
+    bool valid;
+    if (!cache->lookup(key, valid)) {
+      valid = this->checkMutantOnDisk(code);
+      cache->insert(key, valid);
+    }
+    return valid;
+  }
+
+  /// @brief Check syntactically a mutant writing it in a temp file
+  /// @param code The mutant
+  /// @return If the mutant passes the check
+  bool checkMutantOnDisk(::llvm::StringRef code) {
     // Create a temp directory and a temp file
     std::string tempDir = this->mutationTemplate.getTargetOutputDirectory() +
                           this->tempDirName + chimera::fs::pathSep;
@@ -377,7 +768,7 @@ public:
                                     llvm::sys::fs::F_Text);
     if (!tempFile.has_error()) {
       // Write the temp file
-      rw.getEditBuffer(rw.getSourceMgr().getMainFileID()).write(tempFile);
+      tempFile << code;
       tempFile.close(); // Close the file stream
 
       ChimeraLogger::verbose("Building CompilationDatabase");
@@ -432,6 +823,8 @@ public:
   ///          - Mutant Id
   ///          - Location
   ///          - Mutator Identifier
+  ///          The entries with the same id are aliases: different mutations
+  ///          that produce the same mutant.
   void createReportEntry(mutant::IdType id, const std::string &functionName,
                          const SourceLocation &l,
                          const std::string &mutatorIdentifier,
@@ -441,10 +834,22 @@ public:
                            l.printToString(*(this->sourceManager)));
     // Create a fullSource -> a SourceLocation with an associatd SourceManager
     FullSourceLoc fullLoc(l, *(this->sourceManager));
-    this->mutationTemplate.getReportStream()
-        << id << "," << functionName << "," << fullLoc.getSpellingLineNumber()
-        << "," << fullLoc.getSpellingColumnNumber() << "," << mutatorIdentifier
-        << "," << type << std::endl;
+    unsigned line = fullLoc.getSpellingLineNumber();
+    unsigned column = fullLoc.getSpellingColumnNumber();
+    ::std::string entry = ::std::to_string(id) + "," + functionName + "," +
+                          ::std::to_string(line) + "," +
+                          ::std::to_string(column) + "," + mutatorIdentifier +
+                          "," + ::std::to_string(type) + "\n";
+    MutationTemplate *t = &this->mutationTemplate;
+    t->writeOutput([t, entry, id, functionName, line, column,
+                    mutatorIdentifier, type]() {
+      // The stream is flushed when its buffer is full
+      t->getReportStream() << entry;
+      if (t->getBinaryReport() != nullptr) {
+        t->getBinaryReport()->addEntry(id, functionName, line, column,
+                                       mutatorIdentifier, type);
+      }
+    });
   }
 
   ///////////////////////////////////////////////////////////////////////////////
@@ -481,26 +886,51 @@ public:
    */
   virtual void onEndOfTranslationUnit() {
     //    ChimeraLogger::verbose(" [ RUN  ] Cleaning up");
+    // Commit the mutants still in validation, while the AST is alive
+    if (this->mutationTemplate.getValidationPool() != nullptr) {
+      this->mutationTemplate.closeBatch();
+      this->mutationTemplate.getValidationPool()->drain();
+    }
+    if (this->deferCheck) {
+      this->checkDeferredMutant();
+    }
     // Call callbacks: if the mutator is HOM, and so the localMutantId is != 0.
     // Finally the mutant directory exists only if the mutants have been
     // generated.
     if (this->mutator->isHom() && this->localMutantId != 0 &&
         this->mutationTemplate.isGenerateMutants()) {
-      // At this point the mutant has been created
-      this->mutator->onCreatedMutant(
-          this->mutationTemplate.getTargetOutputDirectory() +
-          ::std::to_string(this->localMutantId) + ::chimera::fs::pathSep);
+      // At this point the mutant has been created, the patch storage doesn't
+      // create its directory
+      mutant::IdType id =
+          this->mutationTemplate.getMutantId(this->localMutantId);
+      ::std::string mutantPath =
+          this->mutationTemplate.getMutantStorage()->getMutantDirectory(id);
+      MutatorPtr mutator = this->mutator;
+      mutant::MetadataStore *store =
+          this->mutationTemplate.getMetadataStore();
+      this->mutationTemplate.writeOutput([mutator, mutantPath, id, store]() {
+        if (store != nullptr) {
+          mutator->storeMetadata(id, *store);
+        } else {
+          chimera::fs::createDirectories(mutantPath);
+          mutator->onCreatedMutant(mutantPath);
+        }
+      });
     }
 
-    // Delete temp folder, deleting all files inside
-    ::std::string tempDir = this->mutationTemplate.getTargetOutputDirectory() +
-                            this->tempDirName + chimera::fs::pathSep;
-    // Delete temp file for syntax checking
-    ::llvm::sys::fs::remove(tempDir +
-                            this->mutationTemplate.getTargetFilename());
+    // Only the on-disk validation uses the temp folder
+    if (this->mutationTemplate.getValidationMode() == OnDiskValidation) {
+      // Delete temp folder, deleting all files inside
+      ::std::string tempDir =
+          this->mutationTemplate.getTargetOutputDirectory() +
+          this->tempDirName + chimera::fs::pathSep;
+      // Delete temp file for syntax checking
+      ::llvm::sys::fs::remove(tempDir +
+                              this->mutationTemplate.getTargetFilename());
 
-    // Delete the temp directory
-    ::llvm::sys::fs::remove(tempDir);
+      // Delete the temp directory
+      ::llvm::sys::fs::remove(tempDir);
+    }
 
     //    ChimeraLogger::verbose(" [ DONE ] Cleaning up");
   }
@@ -515,19 +945,22 @@ private:
   ///        influences the retrieve
   ///        of the rewriter.
   mutant::IdType localMutantId;
+  /// @brief If the mutant is checked once, at the end of the translation
+  ///        unit. Only the HOM mutants with a reserved id are, the others
+  ///        start from the original only until a mutation is valid.
+  const bool deferCheck;
   const ::std::string tempDirName; ///< Temporary directory
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 // Class MutationTemplate Implementation
 
-static SlotManager<m_operator::IdType, mutant::IdType> idManager;
+chimera::MutationTemplate::~MutationTemplate() {}
 
 // Private methods
 void chimera::MutationTemplate::initMutantIds_() {
   // Reset slot manager
-  idManager = SlotManager<m_operator::IdType, mutant::IdType>();
-  rwManager = SlotManager<mutant::IdType, Rewriter>();
+  this->mutantSlots.reset(new MutantSlots());
   // Reset mutant counter
   this->mutantCounter = mutantCounterInitial;
   // Loop on operators to find HOM and reserve their ids.
@@ -538,8 +971,9 @@ void chimera::MutationTemplate::initMutantIds_() {
       // Set a slot that binds operator and an identifier, that will be used for
       // all its HOM mutators
       reservedId = this->mutantCounter;
-      if (!idManager.setSlot(op.second->getIdentifier(), reservedId) ||
-          !rwManager.reserve(reservedId)) {
+      if (!this->mutantSlots->idManager.setSlot(op.second->getIdentifier(),
+                                                reservedId) ||
+          !this->mutantSlots->rwManager.reserve(reservedId)) {
         ChimeraLogger::fatal("Couldn't reserve a mutantId for an operator. "
                              "Maybe a mutantId duplicate or memory issues.");
       }
@@ -558,9 +992,15 @@ void chimera::MutationTemplate::addMatchers_(
     const std::string &functionName) {
   // Manage FOM and HOM operator, the mutators are managed inside the callback
   mutant::IdType reservedId = 0;
-  if (this->operators.at(operatorId)->isHom()) {
+  const bool isHomOperator = this->operators.at(operatorId)->isHom();
+  if (isHomOperator && !this->isInShard(operatorId)) {
+    ChimeraLogger::verbose("Operator " + operatorId + " in another shard");
+    return;
+  }
+  if (isHomOperator) {
     // Retrieve reservedId
-    if (!idManager.getReservedSlot(operatorId, reservedId)) {
+    if (!this->mutantSlots->idManager.getReservedSlot(operatorId,
+                                                      reservedId)) {
       ChimeraLogger::fatal("An id wasn't reserved for this operator.");
     }
   }
@@ -573,6 +1013,13 @@ void chimera::MutationTemplate::addMatchers_(
   }
   // Loop on mutators
   for (unsigned j = 0; j < mutators.size(); ++j) {
+    // A HOM mutator of a FOM operator is a single mutant too
+    if (!isHomOperator && mutators[j]->isHom() &&
+        !this->isInShard(mutators[j]->getIdentifier())) {
+      ChimeraLogger::verbose("Mutator " + mutators[j]->getIdentifier() +
+                             " in another shard");
+      continue;
+    }
     // Create the callback for this mutator
     // TODO Manage deallocation of callbackObj
     MutatorMatcherCallback *callbackObj =
@@ -662,16 +1109,129 @@ int chimera::MutationTemplate::run(clang::ast_matchers::MatchFinder &finder) {
     
     // Open report stream
     if (this->openReportStream("report.csv")) {
+      if (this->generateBinaryReport) {
+        this->binaryReport.reset(new mutant::BinaryReportWriter());
+      }
       // retval = this->tool.run(newFrontendActionFactory(&finder).get());
       // Run the ClangTool on a Finder FrontendAction
       // FIXME: Instead of using the ClantTool it coulbe be used directly the
       // CompilerInvocation.
-      
+
+      this->validationStatistics.reset();
+      this->firstOccurrences.clear();
+      this->locationIds = mutant::LocationIdMap();
+      this->mutantIds.clear();
+
+      // Start the validation threads, each with its own session. The batches
+      // are checked by the threads too.
+      if (this->validationJobs > 1 || this->validationBatch > 1) {
+        if (this->validationMode == InMemoryValidation) {
+          ChimeraLogger::verbose("Checking mutants with " +
+                                 ::std::to_string(this->validationJobs) +
+                                 " threads");
+          // Room for a few full batches per thread
+          ::std::size_t maxInFlight =
+              this->validationBatch > 1
+                  ? 8 * this->validationBatch * this->validationJobs
+                  : 0;
+          this->validationPool.reset(new ValidationPool(
+              ::std::max(1u, this->validationJobs),
+              [this]() { return this->createValidationSession_(); },
+              maxInFlight));
+        } else {
+          ChimeraLogger::warning("The on-disk validation shares a temp file, "
+                                 "checking mutants serially");
+        }
+      }
+      if (this->validationPool && this->validationBatch > 1) {
+        // The batches clone the functions of the target as it is parsed
+        auto buffer = ::llvm::MemoryBuffer::getFile(this->targetPath);
+        if (buffer) {
+          ChimeraLogger::verbose("Checking mutants in batches of " +
+                                 ::std::to_string(this->validationBatch));
+          this->openBatch.reset(new MutantBatch(
+              ::std::make_shared<const ::std::string>(
+                  (*buffer)->getBuffer().str()),
+              this->validationBatch));
+        } else {
+          ChimeraLogger::warning("Couldn't read the target, checking mutants "
+                                 "without batches");
+        }
+      }
+
+      if (isGenerateMutants()) {
+        this->createMutantStorage_();
+        this->createMutantSink_();
+        if (this->runMetadataStore != nullptr) {
+          this->metadataStore.reset(new mutant::MetadataStore());
+        }
+      }
+      // The writes are performed by a thread, while matching goes on
+      if (this->outputQueueSize != 0) {
+        this->outputQueue.reset(new OutputQueue(this->outputQueueSize));
+      }
+
       retval = (ClangTool(::chimera::cd_utils::FlexibleCompilationDatabase(
                               this->compileCommand),
                           this->targetPath))
                    .run(newFrontendActionFactory(&finder).get());
 
+      // Commit the last mutants and stop the threads
+      this->closeBatch();
+      this->openBatch.reset();
+      this->validationPool.reset();
+      // Complete the writes
+      this->outputQueue.reset();
+      this->mutantSink.reset();
+      this->targetCode.clear();
+      this->mutantStorage.reset();
+      if (this->binaryReport) {
+        if (!this->binaryReport->write(
+                this->getTargetOutputDirectory() +
+                mutant::BinaryReportWriter::reportFileName)) {
+          ChimeraLogger::error("Couldn't write the binary report");
+        }
+        this->binaryReport.reset();
+      }
+      if (this->idScheme == mutant::LocationIds &&
+          !this->locationIds.write(this->getTargetOutputDirectory() +
+                                   mutant::LocationIdMap::mapFileName)) {
+        ChimeraLogger::error("Couldn't write the map of the mutant ids");
+      }
+      if (this->metadataStore) {
+        if (!this->runMetadataStore->add(this->targetPath,
+                                         *this->metadataStore)) {
+          ChimeraLogger::error("The metadata store has already mutants of " +
+                               this->targetPath);
+        }
+        this->metadataStore.reset();
+      }
+
+      // Report the checks
+      ::std::string rejections;
+      unsigned long rejected = 0;
+      for (unsigned v = prefilter::Plausible + 1; v < prefilter::NumVerdicts;
+           ++v) {
+        unsigned long n = this->validationStatistics.prefilterRejected[v];
+        if (n != 0) {
+          rejections += (rejected != 0 ? ", " : "") + ::std::to_string(n) +
+                        " " + prefilter::getVerdictName(prefilter::Verdict(v));
+          rejected += n;
+        }
+      }
+      ChimeraLogger::info(
+          this->getTargetFilename().str() + ": " +
+          ::std::to_string(this->validationStatistics.checked) +
+          " mutants checked, " +
+          ::std::to_string(this->validationStatistics.syntaxSafe) +
+          " syntax safe, " +
+          ::std::to_string(this->validationStatistics.astDecided) +
+          " decided on the AST, " +
+          ::std::to_string(this->validationStatistics.duplicates) +
+          " duplicates, " + ::std::to_string(rejected) +
+          " rejected by the prefilter" +
+          (rejected != 0 ? " (" + rejections + ")" : ""));
+
       this->closeReportStream();
 
       // After-run tasks:
@@ -703,7 +1263,8 @@ int chimera::MutationTemplate::run(clang::ast_matchers::MatchFinder &finder) {
 chimera::MutationTemplate::MutationTemplate(
     const clang::tooling::CompileCommand &compileCommand,
     std::string targetPath, std::string outputDirectory)
-    : mutantCounter(mutantCounterInitial), compileCommand(compileCommand),
+    : mutantCounter(mutantCounterInitial), mutantSlots(new MutantSlots()),
+      compileCommand(compileCommand),
       // In order to avoid multiple execution and problems with locations (they
       // became invalid)
       // the tool it's build with a CompilationDatabase with only one
@@ -713,7 +1274,20 @@ chimera::MutationTemplate::MutationTemplate(
       // provided, independently of target
       tool(chimera::cd_utils::FlexibleCompilationDatabase(this->compileCommand),
            targetPath),
-      generateMutantsReport(false), generateMutants(false), reportStream() {
+      generateMutantsReport(false), generateMutants(false),
+      storageFormat(mutant::FilesStorage), mutantStorage(nullptr),
+      mutantStream(nullptr), mutantSink(nullptr), targetCode(),
+      compressOutput(false), outputQueueSize(256), outputQueue(nullptr),
+      validationMode(OnDiskValidation), usePreamble(false),
+      validationSession(nullptr), validationJobs(1), validationCache(nullptr),
+      usePrefilter(true), validationStatistics(), validationPool(nullptr),
+      validationBatch(1), openBatch(nullptr), paranoid(false),
+      useOperatorValidator(true), deduplicate(true), firstOccurrences(),
+      idScheme(mutant::SequentialIds), locationIds(), mutantIds(),
+      shardIndex(0), shardCount(1),
+      generateBinaryReport(false), binaryReport(nullptr),
+      runMetadataStore(nullptr), metadataStore(nullptr), reportStream(),
+      compressedReportStream(nullptr) {
   chimera::log::ChimeraLogger::verboseAndIncr(
       "[ RUN  ] Building MutationTemplate");
   this->setOutputDirectory(outputDirectory);
@@ -767,18 +1341,169 @@ int chimera::MutationTemplate::analyze(const conf::FunOpConfMap &map) {
   return run(finder);
 }
 
+void chimera::MutationTemplate::createMutantStorage_() {
+  ::std::string outputDirectory = this->getTargetOutputDirectory();
+  ::std::string filename = this->getTargetFilename().str();
+  if (this->storageFormat == mutant::PatchStorage) {
+    // The edits refer to the target as it is parsed
+    auto buffer = ::llvm::MemoryBuffer::getFile(this->targetPath);
+    if (buffer) {
+      ChimeraLogger::verbose("Storing mutants as patches in " +
+                             outputDirectory);
+      this->mutantStorage.reset(new mutant::PatchMutantStorage(
+          outputDirectory, filename, (*buffer)->getBuffer().str()));
+      return;
+    }
+    ChimeraLogger::warning("Couldn't read the target, storing a copy per "
+                           "mutant");
+  } else if (this->storageFormat == mutant::ArchiveStorage) {
+    ChimeraLogger::verbose("Storing mutants in the archive " +
+                           outputDirectory +
+                           mutant::ArchiveMutantStorage::archiveFileName);
+    this->mutantStorage.reset(new mutant::ArchiveMutantStorage(
+        outputDirectory, filename, this->compressOutput));
+    return;
+  }
+  mutant::FileMutantStorage *storage = new mutant::FileMutantStorage(
+      outputDirectory, filename, this->compressOutput);
+  this->mutantStorage.reset(storage);
+  if (!this->compressOutput) {
+    // The mutants are written as slices of the target plus their edits
+    auto buffer = ::llvm::MemoryBuffer::getFile(this->targetPath);
+    if (buffer) {
+      storage->setOriginal((*buffer)->getBuffer().str(), this->targetPath);
+    }
+  }
+}
+
+mutant::IdType chimera::MutationTemplate::getMutantId(
+    mutant::IdType internalId, const ::std::string &functionName,
+    unsigned line, unsigned column, const ::std::string &mutatorIdentifier,
+    unsigned type) {
+  if (this->idScheme == mutant::SequentialIds) {
+    return internalId;
+  }
+  auto it = this->mutantIds.find(internalId);
+  if (it != this->mutantIds.end()) {
+    return it->second;
+  }
+  bool collided;
+  mutant::IdType id = this->locationIds.assign(
+      this->getTargetFilename(), functionName, line, column,
+      mutatorIdentifier, type, collided);
+  if (collided) {
+    ChimeraLogger::warning("Mutant id already taken in " + functionName +
+                           " at " + ::std::to_string(line) + ":" +
+                           ::std::to_string(column) + ", probed to " +
+                           ::std::to_string(id));
+  }
+  this->mutantIds[internalId] = id;
+  return id;
+}
+
+mutant::IdType
+chimera::MutationTemplate::getMutantId(mutant::IdType internalId) const {
+  auto it = this->mutantIds.find(internalId);
+  return it != this->mutantIds.end() ? it->second : internalId;
+}
+
+bool chimera::MutationTemplate::isInShard(
+    const ::std::string &functionName, unsigned line, unsigned column,
+    const ::std::string &mutatorIdentifier, unsigned type) const {
+  if (this->shardCount <= 1) {
+    return true;
+  }
+  // The same key of the location id
+  return mutant::computeLocationKey(this->getTargetFilename(), functionName,
+                                    line, column, mutatorIdentifier, type) %
+             this->shardCount ==
+         this->shardIndex;
+}
+
+bool chimera::MutationTemplate::isInShard(
+    const ::std::string &identifier) const {
+  return this->isInShard("", 0, 0, identifier, 0);
+}
+
+void chimera::MutationTemplate::createMutantSink_() {
+  if (this->mutantStream != nullptr) {
+    // The edits refer to the target as it is parsed
+    auto buffer = ::llvm::MemoryBuffer::getFile(this->targetPath);
+    if (buffer) {
+      ChimeraLogger::verbose("Streaming the mutants of " + this->targetPath);
+      this->targetCode = (*buffer)->getBuffer().str();
+      return;
+    }
+    ChimeraLogger::warning("Couldn't read the target, storing the mutants "
+                           "of " + this->targetPath);
+  }
+  this->mutantSink.reset(
+      new mutant::StorageMutantSink(this->mutantStorage.get()));
+}
+
+::std::unique_ptr<chimera::ValidationSession>
+chimera::MutationTemplate::createValidationSession_() const {
+  // The session overlays the mutants on the absolute target path
+  CompileCommand command = this->compileCommand;
+  ::chimera::cd_utils::changeCompileCommandTarget(command, this->targetPath,
+                                                  this->targetPath, true);
+  ::std::unique_ptr<ValidationSession> session(
+      new ValidationSession(command, this->targetPath, this->usePreamble));
+  session->setCache(this->validationCache);
+  return session;
+}
+
+chimera::ValidationSession &chimera::MutationTemplate::getValidationSession() {
+  if (!this->validationSession) {
+    this->validationSession = this->createValidationSession_();
+  }
+  return *this->validationSession;
+}
+
+void chimera::MutationTemplate::closeBatch() {
+  if (!this->openBatch) {
+    return;
+  }
+  // The pool job shares the batch, a new one collects the next mutants
+  ::std::shared_ptr<MutantBatch> batch(::std::move(this->openBatch));
+  this->validationPool->closeGroup(
+      [batch](ValidationSession &session) { return batch->check(session); });
+  this->openBatch.reset(
+      new MutantBatch(batch->getOriginal(), this->validationBatch));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Report Stream Functions
+/// @brief Size of the buffer of the report stream
+static const std::size_t reportBufferSize = 1 << 20;
+
 bool chimera::MutationTemplate::openReportStream(const char *reportName) {
-  this->reportStream.open(this->getTargetOutputDirectory() + reportName,
-                          std::ofstream::out);
+  std::string reportPath = this->getTargetOutputDirectory() + reportName;
+  if (this->compressOutput) {
+    this->compressedReportStream.reset(
+        new compression::GzipOStream(reportPath + ".gz"));
+    return this->compressedReportStream->is_open();
+  }
+  // The entries are flushed when the buffer is full
+  this->reportBuffer.resize(reportBufferSize);
+  this->reportStream.rdbuf()->pubsetbuf(this->reportBuffer.data(),
+                                        this->reportBuffer.size());
+  this->reportStream.open(reportPath, std::ofstream::out);
   return this->reportStream.is_open();
 }
 
 std::ostream &chimera::MutationTemplate::getReportStream() {
+  if (this->compressedReportStream) {
+    return *this->compressedReportStream;
+  }
   return this->reportStream;
 }
 
 void chimera::MutationTemplate::closeReportStream() {
+  if (this->compressedReportStream) {
+    this->compressedReportStream->close();
+    this->compressedReportStream.reset();
+    return;
+  }
   this->reportStream.close();
 }
@@ -0,0 +1,416 @@
+//===- ShardMerge.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ShardMerge.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the merge of the outputs of a sharded run
+//===----------------------------------------------------------------------===//
+
+#include "Core/ShardMerge.h"
+#include "Core/Compression.h"
+#include "Core/MetadataStore.h"
+#include "Core/MutantIds.h"
+#include "Core/MutantReport.h"
+#include "Core/MutantStorage.h"
+#include "Log.h"
+#include "Utils.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+using namespace chimera::mutant;
+using namespace chimera::log;
+
+namespace {
+/// @brief Name of the textual report, without the compression suffix
+const char reportFileName[] = "report.csv";
+
+/// @brief Read a whole file, uncompressing it if it is a gzip file
+bool readFile(const ::std::string &path, bool compressed,
+              ::std::string &data) {
+  if (compressed) {
+    return chimera::compression::readGzipFile(path, data);
+  }
+  auto buffer = ::llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    return false;
+  }
+  data = (*buffer)->getBuffer().str();
+  return true;
+}
+
+/// @brief Write a whole file, compressing it if requested
+bool writeFile(const ::std::string &path, bool compress,
+               ::llvm::StringRef data) {
+  if (compress) {
+    return chimera::compression::writeGzipFile(path, data);
+  }
+  ::std::error_code error;
+  ::llvm::raw_fd_ostream file(path, error, ::llvm::sys::fs::F_None);
+  if (error) {
+    return false;
+  }
+  file << data;
+  file.close();
+  return !file.has_error();
+}
+
+/// @brief Split the lines of a file, without the empty ones
+::std::vector<::llvm::StringRef> splitLines(::llvm::StringRef data) {
+  ::llvm::SmallVector<::llvm::StringRef, 256> lines;
+  data.split(lines, '\n', -1, false);
+  return ::std::vector<::llvm::StringRef>(lines.begin(), lines.end());
+}
+
+/// @brief Merge the textual reports, sorted by id, and rebuild the binary one
+/// if a shard wrote it
+bool mergeReports(const ::std::vector<::std::string> &shards,
+                  const ::std::string &outputDirectory) {
+  ::std::vector<::std::string> contents;
+  bool found = false, compressed = false, binary = false;
+  for (const ::std::string &shard : shards) {
+    ::std::string path = shard + reportFileName;
+    bool gz = !::llvm::sys::fs::exists(path) &&
+              ::llvm::sys::fs::exists(path + ".gz");
+    binary |=
+        ::llvm::sys::fs::exists(shard + BinaryReportWriter::reportFileName);
+    if (!gz && !::llvm::sys::fs::exists(path)) {
+      continue;
+    }
+    contents.emplace_back();
+    if (!readFile(gz ? path + ".gz" : path, gz, contents.back())) {
+      ChimeraLogger::error("Couldn't read the report of " + shard);
+      return false;
+    }
+    found = true;
+    compressed |= gz;
+  }
+  if (!found) {
+    return true;
+  }
+
+  // Rows: id,function,line,column,mutator,type
+  ::std::vector<::std::pair<IdType, ::llvm::StringRef>> rows;
+  for (const ::std::string &content : contents) {
+    for (::llvm::StringRef row : splitLines(content)) {
+      IdType id = 0;
+      row.split(',').first.getAsInteger(10, id);
+      rows.emplace_back(id, row);
+    }
+  }
+  ::std::stable_sort(rows.begin(), rows.end(),
+                     [](const ::std::pair<IdType, ::llvm::StringRef> &a,
+                        const ::std::pair<IdType, ::llvm::StringRef> &b) {
+                       return a.first < b.first;
+                     });
+  ::std::string merged;
+  BinaryReportWriter binaryReport;
+  for (const auto &row : rows) {
+    merged += row.second;
+    merged += '\n';
+    if (binary) {
+      // The function name is the only field that could contain a comma
+      ::llvm::StringRef rest = row.second.split(',').second, field;
+      unsigned fields[3];
+      ::std::string mutator;
+      ::std::tie(rest, field) = rest.rsplit(',');
+      field.getAsInteger(10, fields[2]);
+      ::std::tie(rest, field) = rest.rsplit(',');
+      mutator = field.str();
+      ::std::tie(rest, field) = rest.rsplit(',');
+      field.getAsInteger(10, fields[1]);
+      ::std::tie(rest, field) = rest.rsplit(',');
+      field.getAsInteger(10, fields[0]);
+      binaryReport.addEntry(row.first, rest.str(), fields[0], fields[1],
+                            mutator, fields[2]);
+    }
+  }
+  ::std::string path = outputDirectory + reportFileName;
+  if (!writeFile(compressed ? path + ".gz" : path, compressed, merged)) {
+    ChimeraLogger::error("Couldn't write the report in " + outputDirectory);
+    return false;
+  }
+  if (binary &&
+      !binaryReport.write(outputDirectory +
+                          BinaryReportWriter::reportFileName)) {
+    ChimeraLogger::error("Couldn't write the binary report in " +
+                         outputDirectory);
+    return false;
+  }
+  return true;
+}
+
+/// @brief Check that no mutant id is taken by two shards
+bool checkIds(const ::std::vector<::std::string> &shards) {
+  ::std::map<IdType, ::std::size_t> owners;  ///< Shard of each id
+  bool unique = true;
+  for (::std::size_t s = 0; s < shards.size(); ++s) {
+    ::std::string path = shards[s] + LocationIdMap::mapFileName;
+    if (!::llvm::sys::fs::exists(path)) {
+      continue;
+    }
+    ::std::string content;
+    if (!readFile(path, false, content)) {
+      ChimeraLogger::error("Couldn't read the ids of " + shards[s]);
+      return false;
+    }
+    // Rows: Dense,Id,Key,Function,Line,Column,Mutator,Type
+    ::std::vector<::llvm::StringRef> lines = splitLines(content);
+    for (::std::size_t i = 1; i < lines.size(); ++i) {
+      IdType id;
+      if (lines[i].split(',').second.split(',').first.getAsInteger(10, id)) {
+        ChimeraLogger::error("Malformed ids in " + path);
+        return false;
+      }
+      auto it = owners.insert(::std::make_pair(id, s)).first;
+      if (it->second != s) {
+        ChimeraLogger::error("The mutant id " + ::std::to_string(id) +
+                             " is taken by " + shards[it->second] + " and " +
+                             shards[s]);
+        unique = false;
+      }
+    }
+  }
+  return unique;
+}
+
+/// @brief Merge the id maps, sorted by key, with a new dense index
+bool mergeIds(const ::std::vector<::std::string> &shards,
+              const ::std::string &outputDirectory) {
+  ::std::vector<::std::string> contents;
+  for (const ::std::string &shard : shards) {
+    ::std::string path = shard + LocationIdMap::mapFileName;
+    if (!::llvm::sys::fs::exists(path)) {
+      continue;
+    }
+    contents.emplace_back();
+    if (!readFile(path, false, contents.back())) {
+      ChimeraLogger::error("Couldn't read the ids of " + shard);
+      return false;
+    }
+  }
+  if (contents.empty()) {
+    return true;
+  }
+
+  // Rows: Dense,Id,Key,Function,Line,Column,Mutator,Type, the key has a
+  // fixed width and sorts as text
+  struct Row {
+    ::llvm::StringRef key;
+    ::llvm::StringRef rest;  ///< From the id to the end
+  };
+  ::std::vector<Row> rows;
+  for (const ::std::string &content : contents) {
+    ::std::vector<::llvm::StringRef> lines = splitLines(content);
+    for (::std::size_t i = 1; i < lines.size(); ++i) {
+      Row row;
+      row.rest = lines[i].split(',').second;
+      row.key = row.rest.split(',').second.split(',').first;
+      rows.push_back(row);
+    }
+  }
+  ::std::stable_sort(rows.begin(), rows.end(),
+                     [](const Row &a, const Row &b) { return a.key < b.key; });
+  ::std::string merged = "Dense,Id,Key,Function,Line,Column,Mutator,Type\n";
+  ::std::size_t dense = 0;
+  for (const Row &row : rows) {
+    merged += ::std::to_string(++dense) + "," + row.rest.str() + "\n";
+  }
+  if (!writeFile(outputDirectory + LocationIdMap::mapFileName, false,
+                 merged)) {
+    ChimeraLogger::error("Couldn't write the ids in " + outputDirectory);
+    return false;
+  }
+  return true;
+}
+
+/// @brief Copy the mutant directories, <id>/, with the mutant copies and the
+/// artifacts of the mutators
+bool mergeMutantDirectories(const ::std::vector<::std::string> &shards,
+                            const ::std::string &outputDirectory) {
+  bool merged = true;
+  for (const ::std::string &shard : shards) {
+    ::std::error_code error;
+    for (::llvm::sys::fs::directory_iterator dir(shard, error), end;
+         !error && dir != end; dir.increment(error)) {
+      ::llvm::StringRef name = ::llvm::sys::path::filename(dir->path());
+      IdType id;
+      if (name.getAsInteger(10, id) ||
+          !::llvm::sys::fs::is_directory(dir->path())) {
+        continue;
+      }
+      ::std::string mutantDir =
+          outputDirectory + name.str() + chimera::fs::pathSep;
+      if (!chimera::fs::createDirectories(mutantDir)) {
+        ChimeraLogger::error("Couldn't create " + mutantDir);
+        merged = false;
+        continue;
+      }
+      ::std::error_code fileError;
+      for (::llvm::sys::fs::directory_iterator file(dir->path(), fileError);
+           !fileError && file != end; file.increment(fileError)) {
+        if (::llvm::sys::fs::copy_file(
+                file->path(),
+                mutantDir + ::llvm::sys::path::filename(file->path()).str())) {
+          ChimeraLogger::error("Couldn't copy " + file->path());
+          merged = false;
+        }
+      }
+    }
+    if (error) {
+      ChimeraLogger::error("Couldn't read " + shard + ": " + error.message());
+      merged = false;
+    }
+  }
+  return merged;
+}
+
+/// @brief Merge the archives with a name, as the mutants or the metadata
+bool mergeArchives(const ::std::vector<::std::string> &shards,
+                   const ::std::string &outputDirectory,
+                   const ::std::string &archiveName) {
+  ::std::unique_ptr<ArchiveWriter> writer;
+  for (const ::std::string &shard : shards) {
+    ::std::string path = shard + archiveName;
+    if (!::llvm::sys::fs::exists(path)) {
+      continue;
+    }
+    ArchiveMutantReader reader;
+    if (!reader.open(path)) {
+      ChimeraLogger::error("Couldn't read " + path);
+      return false;
+    }
+    if (!writer) {
+      writer.reset(new ArchiveWriter(outputDirectory + archiveName,
+                                     reader.isCompressed()));
+      if (!writer->isOpen()) {
+        return false;
+      }
+    }
+    // Compressed as the archive of the first shard
+    ::std::string code;
+    for (IdType id : reader.getIds()) {
+      if (!reader.read(id, code) || !writer->append(id, code)) {
+        ChimeraLogger::error("Couldn't merge the mutant " +
+                             ::std::to_string(id) + " of " + path);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// @brief Merge the patch storages, the original is the same in all of them
+bool mergePatches(const ::std::vector<::std::string> &shards,
+                  const ::std::string &outputDirectory,
+                  const ::std::string &filename) {
+  ::std::unique_ptr<PatchMutantStorage> storage;
+  ::std::string original;
+  for (const ::std::string &shard : shards) {
+    if (!::llvm::sys::fs::exists(shard + PatchMutantStorage::patchFileName)) {
+      continue;
+    }
+    PatchMutantReader reader;
+    if (!reader.open(shard, filename)) {
+      ChimeraLogger::error("Couldn't read the patch storage of " + shard);
+      return false;
+    }
+    if (!storage) {
+      original = reader.getOriginal();
+      storage.reset(
+          new PatchMutantStorage(outputDirectory, filename, original));
+    } else if (reader.getOriginal() != original) {
+      ChimeraLogger::error("The shards parsed different versions of " +
+                           filename);
+      return false;
+    }
+    ::std::string code;
+    for (IdType id : reader.getIds()) {
+      if (!reader.read(id, code) || !storage->store(id, code)) {
+        ChimeraLogger::error("Couldn't merge the mutant " +
+                             ::std::to_string(id) + " of " + shard);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+} // end anonymous namespace
+
+::std::string chimera::mutant::getShardDirectoryName(unsigned index,
+                                                     unsigned count) {
+  return "shard-" + ::std::to_string(index) + "-of-" + ::std::to_string(count);
+}
+
+bool chimera::mutant::mergeShards(
+    const ::std::vector<::std::string> &shardDirectories,
+    const ::std::string &outputDirectory, const ::std::string &filename) {
+  ChimeraLogger::verbose("Merging " +
+                         ::std::to_string(shardDirectories.size()) +
+                         " shards in " + outputDirectory);
+  // An id taken by two shards would mix their mutants in the directory, the
+  // storages and the report of that id, so nothing is written
+  if (!checkIds(shardDirectories)) {
+    ChimeraLogger::error("The shards of " + filename + " aren't merged");
+    return false;
+  }
+  if (!chimera::fs::createDirectories(outputDirectory)) {
+    ChimeraLogger::error("Couldn't create " + outputDirectory);
+    return false;
+  }
+  // Go on after an error, to merge as much as possible
+  bool merged = mergeReports(shardDirectories, outputDirectory);
+  merged &= mergeIds(shardDirectories, outputDirectory);
+  merged &= mergeMutantDirectories(shardDirectories, outputDirectory);
+  merged &= mergeArchives(shardDirectories, outputDirectory,
+                          ArchiveMutantStorage::archiveFileName);
+  merged &= mergePatches(shardDirectories, outputDirectory, filename);
+  return merged;
+}
+
+bool chimera::mutant::mergeMetadataStores(
+    const ::std::vector<::std::string> &shardDirectories,
+    const ::std::string &outputDirectory) {
+  RunMetadataStore store;
+  bool merged = true;
+  for (const ::std::string &shard : shardDirectories) {
+    ::std::string path = shard + RunMetadataStore::storeFileName;
+    if (::llvm::sys::fs::exists(path) && !store.read(path)) {
+      ChimeraLogger::error("Couldn't merge the metadata store " + path);
+      merged = false;
+    }
+  }
+  if (!store.empty() &&
+      !store.write(outputDirectory + RunMetadataStore::storeFileName)) {
+    ChimeraLogger::error("Couldn't write the metadata store in " +
+                         outputDirectory);
+    return false;
+  }
+  return merged;
+}
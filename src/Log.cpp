@@ -32,7 +32,7 @@ INITIALIZE_EASYLOGGINGPP
 const char* chimera::log::ChimeraLogger::loggerName = "chimeraLogger";  ///< Member initialization
 el::Configurations chimera::log::ChimeraLogger::configurator =
     el::Configurations();
-log::VerboseLevel chimera::log::ChimeraLogger::actualVLevel = 0;
+thread_local log::VerboseLevel chimera::log::ChimeraLogger::actualVLevel = 0;
 
 void chimera::log::ChimeraLogger::init() {
   /// Configure el++ : chimeraLogger
@@ -127,3 +127,82 @@ bool chimera::examples::MutatorGreaterOpReplacement::match(
   rw.ReplaceText(op->getSourceRange(), lhs + " " + opReplacement + " " + rhs);
   return rw;
 }
+
+/// \brief If the code of a node belongs to a template or to one of its
+///        instantiations, which share the text
+static bool isInTemplate(const Stmt *stmt, ASTContext &context) {
+  ast_type_traits::DynTypedNode node =
+      ast_type_traits::DynTypedNode::create(*stmt);
+  const Decl *decl = nullptr;
+  while (decl == nullptr) {
+    ASTContext::DynTypedNodeList parents = context.getParents(node);
+    if (parents.empty()) {
+      // Nowhere to look
+      return true;
+    }
+    node = parents[0];
+    decl = node.get<Decl>();
+  }
+  const DeclContext *dc = dyn_cast<DeclContext>(decl);
+  for (dc = dc != nullptr ? dc : decl->getDeclContext(); dc != nullptr;
+       dc = dc->getParent()) {
+    if (dc->isDependentContext()) {
+      return true;
+    }
+    if (const FunctionDecl *f = dyn_cast<FunctionDecl>(dc)) {
+      if (f->getTemplateInstantiationPattern() != nullptr) {
+        return true;
+      }
+    } else if (const CXXRecordDecl *r = dyn_cast<CXXRecordDecl>(dc)) {
+      if (r->getTemplateInstantiationPattern() != nullptr) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/// \brief The builtin > is replaced by the builtin < or <= on the same
+///        operands: they accept the same types and have the same precedence,
+///        so the mutant is valid whenever the original is.
+///        It doesn't hold when the operands depend on a template parameter,
+///        the operators could be overloaded for the instantiation types, nor
+///        when the text is shared with other uses, i.e. for the macros, the
+///        templates and their instantiations.
+bool chimera::examples::MutatorGreaterOpReplacement::isSyntaxSafe(
+    const ::chimera::mutator::NodeType &node,
+    ::chimera::mutator::MutatorType type) const {
+  const BinaryOperator *op = node.Nodes.getNodeAs<BinaryOperator>("greater_op");
+  if (op == nullptr || (type != 0 && type != 1)) {
+    return false;
+  }
+  if (op->isInstantiationDependent() ||
+      op->getLHS()->isInstantiationDependent() ||
+      op->getRHS()->isInstantiationDependent()) {
+    return false;
+  }
+  if (op->getOperatorLoc().isMacroID() || op->getLocStart().isMacroID() ||
+      op->getLocEnd().isMacroID()) {
+    return false;
+  }
+  return !isInTemplate(op, *node.Context);
+}
+
+/// \brief The mutation types replace the operator and keep the operands text
+bool chimera::examples::MutatorGreaterOpReplacement::getOperatorReplacement(
+    const ::chimera::mutator::NodeType &node,
+    ::chimera::mutator::MutatorType type, const ::clang::BinaryOperator *&op,
+    ::clang::BinaryOperatorKind &replacement) {
+  op = node.Nodes.getNodeAs<BinaryOperator>("greater_op");
+  switch (type) {
+  case 0:
+    replacement = BO_LT;
+    break;
+  case 1:
+    replacement = BO_LE;
+    break;
+  default:
+    return false;
+  }
+  return op != nullptr;
+}
@@ -7,6 +7,7 @@
 
 #include "Operators/FLAP/Operator.h"
 #include "Operators/FLAP/Mutators.h"
+#include "Core/MetadataStore.h"
 
 #include "Log.h"
 #include "llvm/Support/Debug.h"
@@ -370,12 +371,8 @@ bool chimera::flapmutator::FLAPFloatOperationMutator::getMatchedNode(
   return rw;
 }
 
-void chimera::flapmutator::FLAPFloatOperationMutator::onCreatedMutant(
-    const ::std::string &mDir) {
-  // Create a specific report inside the mutant directory
-  ::std::error_code error;
-  ::llvm::raw_fd_ostream report(mDir + "flap_float_report.csv", error,
-                                ::llvm::sys::fs::OpenFlags::F_Text);
+::std::vector<chimera::flapmutator::FLAPFloatOperationMutator::MutationInfo>
+chimera::flapmutator::FLAPFloatOperationMutator::resolveMutationsInfo_() const {
   // Resolve operand/operation information, substituting the binary operator
   // with the code of the I type operation
   // This operation, due to the unknown order of processing, has to be performed
@@ -478,8 +475,16 @@ void chimera::flapmutator::FLAPFloatOperationMutator::onCreatedMutant(
     }
   }
 
-  // for (const auto& mutationInfo : this->mutationsInfo) {
-  for (const auto &mutationInfo : cMutationsInfo) {
+  return cMutationsInfo;
+}
+
+void chimera::flapmutator::FLAPFloatOperationMutator::onCreatedMutant(
+    const ::std::string &mDir) {
+  // Create a specific report inside the mutant directory
+  ::std::error_code error;
+  ::llvm::raw_fd_ostream report(mDir + "flap_float_report.csv", error,
+                                ::llvm::sys::fs::OpenFlags::F_Text);
+  for (const auto &mutationInfo : this->resolveMutationsInfo_()) {
     report << mutationInfo.opId << "," << mutationInfo.line << ","
            << mutationInfo.opRetTy << "," << mapOpCode(mutationInfo.opTy) << ","
            << "\"" << mutationInfo.op1 << "\","
@@ -488,3 +493,19 @@ void chimera::flapmutator::FLAPFloatOperationMutator::onCreatedMutant(
   }
   report.close();
 }
+
+void chimera::flapmutator::FLAPFloatOperationMutator::storeMetadata(
+    ::chimera::mutant::IdType id, ::chimera::mutant::MetadataStore &store) {
+  for (const auto &mutationInfo : this->resolveMutationsInfo_()) {
+    ::chimera::mutant::MetadataEntry entry;
+    entry.mutator = this->getIdentifier();
+    entry.operationId = mutationInfo.opId;
+    entry.line = mutationInfo.line;
+    entry.returnType = mutationInfo.opRetTy;
+    entry.operation = mapOpCode(mutationInfo.opTy);
+    entry.operand1 = mutationInfo.op1;
+    entry.operand2 = mutationInfo.op2;
+    entry.returnVariable = mutationInfo.retOp;
+    store.add(id, ::std::move(entry));
+  }
+}
@@ -25,6 +25,7 @@
 
 #include "Log.h"
 #include "Operators/LoopFirst/Mutators.h"
+#include "Core/MetadataStore.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/ADT/APSInt.h"
@@ -329,3 +330,16 @@ void ::chimera::perforation::MutatorLoopPerforation1::onCreatedMutant(
   }
   report.close();
 }
+
+void ::chimera::perforation::MutatorLoopPerforation1::storeMetadata(
+    ::chimera::mutant::IdType id, ::chimera::mutant::MetadataStore &store) {
+  for (const auto &mutationInfo : this->mutationsInfo) {
+    ::chimera::mutant::MetadataEntry entry;
+    entry.mutator = this->getIdentifier();
+    entry.operationId = mutationInfo.opId;
+    entry.line = mutationInfo.line;
+    entry.increment = mutationInfo.inc;
+    entry.tripCount = mutationInfo.forLenght;
+    store.add(id, ::std::move(entry));
+  }
+}
@@ -25,6 +25,7 @@
 
 #include "Log.h"
 #include "Operators/LoopSecond/Mutators.h"
+#include "Core/MetadataStore.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Debug.h"
 #include <iostream>
@@ -322,4 +323,17 @@ void ::chimera::perforation::MutatorLoopPerforation2::onCreatedMutant(
   report.close();
 }
 
+void ::chimera::perforation::MutatorLoopPerforation2::storeMetadata(
+    ::chimera::mutant::IdType id, ::chimera::mutant::MetadataStore &store) {
+  for (const auto &mutationInfo : this->mutationsInfo) {
+    ::chimera::mutant::MetadataEntry entry;
+    entry.mutator = this->getIdentifier();
+    entry.operationId = mutationInfo.opId;
+    entry.line = mutationInfo.line;
+    entry.increment = mutationInfo.inc;
+    entry.tripCount = mutationInfo.forLenght;
+    store.add(id, ::std::move(entry));
+  }
+}
+
 
@@ -25,6 +25,7 @@
 
 #include "Operators/VPA_Native/Operator.h"
 #include "Operators/VPA_Native/Mutators.h"
+#include "Core/MetadataStore.h"
 
 #include "Log.h"
 #include "llvm/Support/Debug.h"
@@ -531,12 +532,8 @@ bool chimera::vpa_nmutator::VPANFloatOperationMutator::getMatchedNode(
   return rw;
 }
 
-void chimera::vpa_nmutator::VPANFloatOperationMutator::onCreatedMutant(
-    const ::std::string &mDir) {
-  // Create a specific report inside the mutant directory
-  ::std::error_code error;
-  ::llvm::raw_fd_ostream report(mDir + "vpa_n_float_report.csv", error,
-                                ::llvm::sys::fs::OpenFlags::F_Text);
+::std::vector<chimera::vpa_nmutator::VPANFloatOperationMutator::MutationInfo>
+chimera::vpa_nmutator::VPANFloatOperationMutator::resolveMutationsInfo_() const {
   // Resolve operand/operation information, substituting the binary operator
   // with the code of the I type operation
   // This operation, due to the unknown order of processing, has to be performed
@@ -648,8 +645,16 @@ void chimera::vpa_nmutator::VPANFloatOperationMutator::onCreatedMutant(
     }
   }
 
-  // for (const auto& mutationInfo : this->mutationsInfo) {
-  for (const auto &mutationInfo : cMutationsInfo) {
+  return cMutationsInfo;
+}
+
+void chimera::vpa_nmutator::VPANFloatOperationMutator::onCreatedMutant(
+    const ::std::string &mDir) {
+  // Create a specific report inside the mutant directory
+  ::std::error_code error;
+  ::llvm::raw_fd_ostream report(mDir + "vpa_n_float_report.csv", error,
+                                ::llvm::sys::fs::OpenFlags::F_Text);
+  for (const auto &mutationInfo : this->resolveMutationsInfo_()) {
     report << mutationInfo.opId << "," << mutationInfo.line << ","
            << mutationInfo.opRetTy << "," << mapOpCode(mutationInfo.opTy) << ","
            << "\"" << mutationInfo.op1 << "\","
@@ -658,3 +663,19 @@ void chimera::vpa_nmutator::VPANFloatOperationMutator::onCreatedMutant(
   }
   report.close();
 }
+
+void chimera::vpa_nmutator::VPANFloatOperationMutator::storeMetadata(
+    ::chimera::mutant::IdType id, ::chimera::mutant::MetadataStore &store) {
+  for (const auto &mutationInfo : this->resolveMutationsInfo_()) {
+    ::chimera::mutant::MetadataEntry entry;
+    entry.mutator = this->getIdentifier();
+    entry.operationId = mutationInfo.opId;
+    entry.line = mutationInfo.line;
+    entry.returnType = mutationInfo.opRetTy;
+    entry.operation = mapOpCode(mutationInfo.opTy);
+    entry.operand1 = mutationInfo.op1;
+    entry.operand2 = mutationInfo.op2;
+    entry.returnVariable = mutationInfo.retOp;
+    store.add(id, ::std::move(entry));
+  }
+}
@@ -25,26 +25,44 @@
 ///        Google C++ Test Framework
 //===----------------------------------------------------------------------===//
 
+#include "Core/MutantIds.h"
+#include "Core/MutantStorage.h"
 #include "Core/Mutator.h"
+#include "Core/ShardMerge.h"
 #include "Testing/ChimeraTest.h"
+#include "Tooling/DeferredMutant.h"
+#include "Tooling/LexicalPrefilter.h"
+#include "Tooling/OperatorValidator.h"
+#include "Tooling/ValidationCache.h"
 
 #include "Log.h"
 #include "Utils.h"
 #include "clang/Tooling/Tooling.h"
+#include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "lib/csv.h"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
 
 //#include <boost/filesystem.hpp>
 
 using namespace std;
 using namespace clang::ast_matchers;
 using namespace chimera::fs;
+using namespace chimera::mutant;
 using namespace chimera::mutator;
 using namespace chimera::log;
 
@@ -265,3 +283,636 @@ void chimera::testing::testMutatorMatch(chimera::mutator::Mutator *mutator) {
   } while (testNum != 0);
   LOG_TEST_("Finish Mutator Testing - " + m.getIdentifier());
 }
+
+///////////////////////////////////////////////////////////////////////////////
+/// Validation cache tests
+
+/// @brief Compute the cache key of a check of the code
+static ::chimera::ValidationCache::KeyType
+computeCacheKey(const ::std::string &code) {
+  ::clang::tooling::CompileCommand command;
+  command.Directory = ".";
+  command.CommandLine = {"clang++", "-fsyntax-only", "test.cpp"};
+  return ::chimera::ValidationCache::computeKey(code, command, {});
+}
+
+void chimera::testing::testValidationCacheEviction() {
+  ::llvm::SmallString<128> tempDirectory;
+  ASSERT_FALSE(
+      ::llvm::sys::fs::createUniqueDirectory("chimera-cache", tempDirectory));
+  ValidationCache::KeyType first = computeCacheKey("int a;");
+  ValidationCache::KeyType second = computeCacheKey("int b;");
+  ValidationCache::KeyType third = computeCacheKey("int c;");
+  ASSERT_NE(first, second);
+  ASSERT_EQ(first, computeCacheKey("int a;"));
+  {
+    ValidationCache cache(tempDirectory.str().str(), 2);
+    bool valid = false;
+    EXPECT_FALSE(cache.lookup(first, valid));
+    cache.insert(first, true);
+    cache.insert(second, false);
+    // The lookup makes the first verdict the most recently used
+    ASSERT_TRUE(cache.lookup(first, valid));
+    EXPECT_TRUE(valid);
+    cache.insert(third, true);
+    EXPECT_FALSE(cache.lookup(second, valid)) << "LRU verdict not evicted";
+    ASSERT_TRUE(cache.lookup(first, valid));
+    EXPECT_TRUE(valid);
+    ASSERT_TRUE(cache.lookup(third, valid));
+    EXPECT_TRUE(valid);
+    EXPECT_EQ(3u, cache.getHits());
+    EXPECT_EQ(2u, cache.getMisses());
+  }
+  deleteDirectory(tempDirectory);
+}
+
+void chimera::testing::testValidationCacheRoundTrip() {
+  ::llvm::SmallString<128> tempDirectory;
+  ASSERT_FALSE(
+      ::llvm::sys::fs::createUniqueDirectory("chimera-cache", tempDirectory));
+  ::std::string directory = tempDirectory.str().str();
+  ValidationCache::KeyType first = computeCacheKey("int a;");
+  ValidationCache::KeyType second = computeCacheKey("int b;");
+  ValidationCache::KeyType third = computeCacheKey("int c;");
+  {
+    ValidationCache cache(directory, 3);
+    cache.insert(first, true);
+    cache.insert(second, false);
+    cache.insert(third, true);
+    bool valid;
+    ASSERT_TRUE(cache.lookup(first, valid));
+    ASSERT_TRUE(cache.flush());
+  }
+  {
+    // The verdicts are loaded from the least recently used, the smaller
+    // cache evicts the second one
+    ValidationCache cache(directory, 2);
+    bool valid = true;
+    EXPECT_FALSE(cache.lookup(second, valid)) << "LRU order not kept";
+    ASSERT_TRUE(cache.lookup(first, valid));
+    EXPECT_TRUE(valid);
+    ASSERT_TRUE(cache.lookup(third, valid));
+    EXPECT_TRUE(valid);
+    cache.insert(second, false);
+  }
+  {
+    // The dtor flushes
+    ValidationCache cache(directory, 2);
+    bool valid = true;
+    ASSERT_TRUE(cache.lookup(second, valid));
+    EXPECT_FALSE(valid);
+    EXPECT_FALSE(cache.lookup(first, valid));
+  }
+  deleteDirectory(tempDirectory);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Deferred mutant tests
+
+/// @brief Replace the first occurrence of a text
+static ::std::string replaceFirst(::std::string code, const ::std::string &from,
+                                  const ::std::string &to) {
+  ::std::string::size_type position = code.find(from);
+  EXPECT_NE(::std::string::npos, position) << from << " not found";
+  if (position != ::std::string::npos) {
+    code.replace(position, from.size(), to);
+  }
+  return code;
+}
+
+void chimera::testing::testDeferredMutant() {
+  const ::std::string original = "int max(int a, int b) {\n"
+                                 "  if (a > b) {\n"
+                                 "    return a;\n"
+                                 "  }\n"
+                                 "  return b;\n"
+                                 "}\n"
+                                 "\n"
+                                 "int clamp(int v, int lo, int hi) {\n"
+                                 "  if (v > hi) {\n"
+                                 "    return hi;\n"
+                                 "  }\n"
+                                 "  if (lo > v) {\n"
+                                 "    return lo;\n"
+                                 "  }\n"
+                                 "  return v;\n"
+                                 "}\n";
+  // The broken steps are marked by '@', the check rejects them
+  DeferredMutant::Checker check = [](const ::std::string &code) {
+    return code.find('@') == ::std::string::npos;
+  };
+  ::std::vector<::std::pair<::std::string, ::std::string>> replacements{
+      {"a > b", "a >= b"},
+      {"return b;", "return b @;"},
+      {"v > hi", "v >= hi"},
+      {"lo > v", "lo @ v"},
+      {"return v;", "return lo;"}};
+  DeferredMutant mutant(original);
+  ::std::string code = original;
+  ::std::string expected = original;
+  for (size_t i = 0; i < replacements.size(); ++i) {
+    code = replaceFirst(code, replacements[i].first, replacements[i].second);
+    mutant.addStep(code);
+    if (replacements[i].second.find('@') == ::std::string::npos) {
+      expected =
+          replaceFirst(expected, replacements[i].first, replacements[i].second);
+    }
+  }
+  ASSERT_EQ(replacements.size(), mutant.getSteps());
+
+  ::std::string validated;
+  unsigned checks = 0;
+  ::std::vector<bool> kept = mutant.validate(check, validated, checks);
+  EXPECT_EQ(::std::vector<bool>({true, false, true, false, true}), kept);
+  EXPECT_EQ(expected, validated);
+
+  // A valid mutant is checked once, with all its steps
+  DeferredMutant valid(original);
+  valid.addStep(replaceFirst(original, "a > b", "a >= b"));
+  kept = valid.validate(check, validated, checks);
+  EXPECT_EQ(::std::vector<bool>({true}), kept);
+  EXPECT_EQ(1u, checks);
+  EXPECT_EQ(replaceFirst(original, "a > b", "a >= b"), validated);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Prefilter tests
+
+/// @brief Lengths around the 16 bytes chunks of the vectorized scans
+static const ::std::size_t prefilterLengths[] = {0,  1,  2,  15, 16, 17,
+                                                 31, 32, 33, 47, 48, 49};
+
+void chimera::testing::testPrefilterEditedRegion() {
+  for (::std::size_t length : prefilterLengths) {
+    ::std::string original;
+    for (::std::size_t i = 0; i < length; ++i) {
+      original += char('a' + i % 26);
+    }
+    // Each position is replaced, also with its mirror, removed and preceded
+    // by an insertion
+    ::std::vector<::std::string> mutants{original};
+    for (::std::size_t position = 0; position <= length; ++position) {
+      if (position < length) {
+        ::std::string replaced = original;
+        replaced[position] = '#';
+        mutants.push_back(replaced);
+        replaced[length - position - 1] = '#';
+        mutants.push_back(replaced);
+        mutants.push_back(::std::string(original).erase(position, 1));
+      }
+      mutants.push_back(::std::string(original).insert(position, "#"));
+      mutants.push_back(
+          ::std::string(original).insert(position, ::std::string(17, '#')));
+    }
+    for (const ::std::string &mutant : mutants) {
+      // Scalar reference
+      ::std::size_t shorter = ::std::min(original.size(), mutant.size());
+      ::std::size_t prefix = 0;
+      while (prefix < shorter && original[prefix] == mutant[prefix]) {
+        ++prefix;
+      }
+      ::std::size_t suffix = 0;
+      while (suffix < shorter - prefix &&
+             original[original.size() - suffix - 1] ==
+                 mutant[mutant.size() - suffix - 1]) {
+        ++suffix;
+      }
+      ::std::size_t actualPrefix, actualSuffix;
+      prefilter::findEditedRegion(original, mutant, actualPrefix,
+                                  actualSuffix);
+      EXPECT_EQ(prefix, actualPrefix) << original << " -> " << mutant;
+      EXPECT_EQ(suffix, actualSuffix) << original << " -> " << mutant;
+    }
+  }
+}
+
+void chimera::testing::testPrefilterCounts() {
+  // The characters are placed across the 16 bytes chunks of an edited
+  // region long length
+  struct {
+    const char *characters;
+    prefilter::Verdict verdict;
+  } table[] = {{"(", prefilter::UnbalancedParens},
+               {")", prefilter::UnbalancedParens},
+               {"[", prefilter::UnbalancedBrackets},
+               {"]", prefilter::UnbalancedBrackets},
+               {"{", prefilter::UnbalancedBraces},
+               {"}", prefilter::UnbalancedBraces},
+               {"\"", prefilter::UnbalancedQuotes},
+               {"()", prefilter::Plausible},
+               {"[]", prefilter::Plausible},
+               {"{}", prefilter::Plausible},
+               {"\"\"", prefilter::Plausible}};
+  const ::std::string before = "int f(int a[2]) {\n  return ";
+  const ::std::string after = ";\n}\n";
+  for (::std::size_t length : prefilterLengths) {
+    if (length < 4) {
+      continue;
+    }
+    // The region starts and ends with an edited character
+    ::std::string region = "a" + ::std::string(length - 2, 'x') + "a";
+    ::std::string original = before + region + after;
+    for (const auto &row : table) {
+      ::std::size_t size = ::std::strlen(row.characters);
+      for (::std::size_t position :
+           {::std::size_t(1), ::std::size_t(14), ::std::size_t(15),
+            ::std::size_t(16), ::std::size_t(31), ::std::size_t(32),
+            length - size - 1}) {
+        if (position + size >= length) {
+          continue;
+        }
+        ::std::string mutantRegion = "b" + region.substr(1, length - 2) + "b";
+        mutantRegion.replace(position, size, row.characters);
+        ::std::string mutant = before + mutantRegion + after;
+        // The verdict doesn't depend on which side has the characters
+        EXPECT_EQ(row.verdict, prefilter::check(original, mutant))
+            << mutantRegion;
+        EXPECT_EQ(row.verdict, prefilter::check(mutant, original))
+            << mutantRegion;
+      }
+    }
+  }
+}
+
+void chimera::testing::testPrefilterVerdicts() {
+  struct {
+    const char *original;
+    const char *mutant;
+    prefilter::Verdict verdict;
+  } table[] = {
+      // Balanced edits
+      {"if (a > b) {", "if (a >= b) {", prefilter::Plausible},
+      {"f(a, b);", "f((a), b);", prefilter::Plausible},
+      {"f(g(a));", "f(g(b));", prefilter::Plausible},
+      // Unbalanced edits
+      {"f(a, b);", "f(a, b;", prefilter::UnbalancedParens},
+      {"v[i] = 0;", "v[i = 0;", prefilter::UnbalancedBrackets},
+      {"if (a) { b(); }", "if (a) b(); }", prefilter::UnbalancedBraces},
+      {"s = \"a\";", "s = \"a;", prefilter::UnbalancedQuotes},
+      // The brackets in string and char literals or comments aren't judged
+      {"s = x;", "s = \"(\";", prefilter::Plausible},
+      {"c = x;", "c = '(';", prefilter::Plausible},
+      {"a = b;", "a = b; // (", prefilter::Plausible},
+      {"a = b;", "a = b; /* ( */", prefilter::Plausible},
+      {"a = b;", "a = (b / c;", prefilter::UnbalancedParens},
+      // The quotes in char literals or after escapes aren't judged
+      {"c = x;", "c = '\"';", prefilter::Plausible},
+      {"s = x;", "s = \"\\\"\";", prefilter::Plausible}};
+  for (const auto &row : table) {
+    EXPECT_EQ(row.verdict, prefilter::check(row.original, row.mutant))
+        << row.original << " -> " << row.mutant << ": "
+        << prefilter::getVerdictName(prefilter::check(row.original,
+                                                      row.mutant));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Operator validator tests
+
+void chimera::testing::testOperatorValidatorVerdicts() {
+  struct {
+    const char *code;
+    const char *op; ///< The first operation with this operator is replaced
+    ::clang::BinaryOperatorKind replacement;
+    opvalidator::Verdict verdict;
+  } table[] = {
+      // Builtin operands
+      {"bool f(int a, int b) { return a > b; }", ">", ::clang::BO_LT,
+       opvalidator::Valid},
+      {"bool f(int a, long b) { return a > b; }", ">", ::clang::BO_LE,
+       opvalidator::Valid},
+      {"int f(int a, int b) { return a * b; }", "*", ::clang::BO_Rem,
+       opvalidator::Valid},
+      {"double f(double a, double b) { return a * b; }", "*", ::clang::BO_Rem,
+       opvalidator::Invalid},
+      {"void f(double &a, int b) { a += b; }", "+=", ::clang::BO_ShlAssign,
+       opvalidator::Invalid},
+      // A different result or structure of the text
+      {"bool f(int a, int b) { return a > b; }", ">", ::clang::BO_Add,
+       opvalidator::Unknown},
+      {"int f(int a, int b, int c) { return a + b * c; }", "*",
+       ::clang::BO_Shl, opvalidator::Unknown},
+      // User-defined and non arithmetic types
+      {"enum E { X, Y };\nbool f(E a, E b) { return a > b; }", ">",
+       ::clang::BO_LT, opvalidator::Unknown},
+      {"bool f(int *a, int *b) { return a > b; }", ">", ::clang::BO_LT,
+       opvalidator::Unknown},
+      // Text shared with other uses, constant expressions
+      {"#define GT(a, b) a > b\nbool f(int a, int b) { return GT(a, b); }",
+       ">", ::clang::BO_LT, opvalidator::Unknown},
+      {"template <class T> bool f(T a, int b) { return b > 0; }", ">",
+       ::clang::BO_LT, opvalidator::Unknown},
+      {"bool f() { return 2 > 1; }", ">", ::clang::BO_LT,
+       opvalidator::Unknown}};
+  for (const auto &row : table) {
+    ::std::unique_ptr<::clang::ASTUnit> unit =
+        ::clang::tooling::buildASTFromCode(row.code);
+    ASSERT_TRUE(unit != nullptr) << row.code;
+    ::clang::ASTContext &context = unit->getASTContext();
+    auto matches = match(binaryOperator(hasOperatorName(row.op)).bind("op"),
+                         context);
+    ASSERT_FALSE(matches.empty()) << row.code;
+    const ::clang::BinaryOperator *op =
+        matches[0].getNodeAs<::clang::BinaryOperator>("op");
+    opvalidator::Verdict verdict =
+        opvalidator::check(op, row.replacement, context);
+    EXPECT_EQ(row.verdict, verdict)
+        << row.code << ": " << opvalidator::getVerdictName(verdict);
+    if (verdict == opvalidator::Unknown) {
+      continue;
+    }
+    // A decided verdict must be the one of the frontend
+    ::std::string mutant = row.code;
+    mutant.replace(unit->getSourceManager().getFileOffset(
+                       op->getOperatorLoc()),
+                   ::std::strlen(row.op),
+                   ::clang::BinaryOperator::getOpcodeStr(row.replacement));
+    EXPECT_EQ(verdict == opvalidator::Valid,
+              ::clang::tooling::runToolOnCode(new ::clang::SyntaxOnlyAction,
+                                              mutant))
+        << mutant;
+  }
+}
+
+void chimera::testing::testOperatorValidatorCommandLine() {
+  EXPECT_TRUE(opvalidator::acceptsCommandLine({}));
+  EXPECT_TRUE(opvalidator::acceptsCommandLine(
+      {"clang++", "-O2", "-Wall", "-Wno-error", "-pedantic"}));
+  EXPECT_FALSE(opvalidator::acceptsCommandLine({"clang++", "-Werror"}));
+  EXPECT_FALSE(
+      opvalidator::acceptsCommandLine({"clang++", "-Werror=return-type"}));
+  EXPECT_FALSE(opvalidator::acceptsCommandLine({"-pedantic-errors"}));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Storage tests
+
+/// @brief Read a whole file
+/// @return If the file is read
+static bool readFile(const ::std::string &path, ::std::string &content) {
+  auto buffer = ::llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    return false;
+  }
+  content = (*buffer)->getBuffer().str();
+  return true;
+}
+
+/// @brief Load the target test_N.cpp of the storage fixtures and its mutants
+/// @return If the target exists
+static bool loadStorageFixture(unsigned testNum, ::std::string &targetPath,
+                               ::std::string &original,
+                               ::std::map<IdType, ::std::string> &mutants) {
+  ::std::string testPath = testDirectory + ".." + pathSep + "storage" +
+                           pathSep + "test_" + to_string(testNum);
+  targetPath = testPath + ".cpp";
+  if (!readFile(targetPath, original)) {
+    return false;
+  }
+  mutants.clear();
+  ::std::string code;
+  for (IdType id = 1;
+       readFile(testPath + "_mutant_" + to_string(id) + ".cpp", code); ++id) {
+    mutants[id] = code;
+  }
+  return true;
+}
+
+/// @brief Create a storage of the mutants of a target
+static MutantStorage *createStorage(StorageFormat format,
+                                    const ::std::string &outputDirectory,
+                                    const ::std::string &filename,
+                                    const ::std::string &original,
+                                    bool compress) {
+  switch (format) {
+  case PatchStorage:
+    return new PatchMutantStorage(outputDirectory, filename, original);
+  case ArchiveStorage:
+    return new ArchiveMutantStorage(outputDirectory, filename, compress);
+  default:
+    return new FileMutantStorage(outputDirectory, filename, compress);
+  }
+}
+
+void chimera::testing::testStorage(StorageFormat format, bool compress) {
+  ::std::string targetPath;
+  ::std::string original;
+  ::std::map<IdType, ::std::string> mutants;
+  unsigned testNum = 0;
+  for (; loadStorageFixture(testNum, targetPath, original, mutants);
+       ++testNum) {
+    LOG_TEST_("Storing the mutants of " + targetPath);
+    ASSERT_FALSE(mutants.empty()) << "No mutant of " << targetPath;
+    ::llvm::SmallString<128> tempDirectory;
+    ASSERT_FALSE(::llvm::sys::fs::createUniqueDirectory("chimera-storage",
+                                                        tempDirectory));
+    ::std::string filename = "test_" + to_string(testNum) + ".cpp";
+    ::std::string filesDirectory =
+        tempDirectory.str().str() + pathSep + "files" + pathSep;
+    ::std::string storageDirectory =
+        tempDirectory.str().str() + pathSep + "storage" + pathSep;
+    ASSERT_TRUE(createDirectories(filesDirectory));
+    ASSERT_TRUE(createDirectories(storageDirectory));
+    {
+      // The storages are complete once destroyed
+      FileMutantStorage files(filesDirectory, filename, compress);
+      if (!compress) {
+        files.setOriginal(original, targetPath);
+      }
+      ::std::unique_ptr<MutantStorage> storage(createStorage(
+          format, storageDirectory, filename, original, compress));
+      for (const auto &mutant : mutants) {
+        ASSERT_TRUE(files.store(mutant.first, mutant.second));
+        ASSERT_TRUE(storage->store(mutant.first, mutant.second));
+      }
+    }
+
+    // Read back the mutants as -extract
+    MutantExtractor fromFiles;
+    MutantExtractor fromStorage;
+    ASSERT_TRUE(fromFiles.open(filesDirectory, filename));
+    ASSERT_TRUE(fromStorage.open(storageDirectory, filename));
+    EXPECT_EQ(format, fromStorage.getFormat());
+    for (const auto &mutant : mutants) {
+      ::std::string fileCode;
+      ::std::string storageCode;
+      ASSERT_TRUE(fromFiles.read(mutant.first, fileCode))
+          << "Mutant " << mutant.first << " not found in the copies";
+      ASSERT_TRUE(fromStorage.read(mutant.first, storageCode))
+          << "Mutant " << mutant.first << " not found in the storage";
+      EXPECT_EQ(mutant.second, fileCode) << "Mutant " << mutant.first;
+      EXPECT_EQ(fileCode, storageCode) << "Mutant " << mutant.first;
+    }
+    ::std::string code;
+    EXPECT_FALSE(fromStorage.read(mutants.rbegin()->first + 1, code))
+        << "Read a mutant that wasn't stored";
+    deleteDirectory(tempDirectory);
+  }
+  ASSERT_NE(0u, testNum) << "No storage fixture found";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Mutant ids tests
+
+void chimera::testing::testLocationIds() {
+  LocationIdMap ids;
+  bool collided = true;
+  IdType first = ids.assign("test_0.cpp", "max", 2, 7, "m", 0, collided);
+  EXPECT_FALSE(collided);
+  EXPECT_NE(0u, first);
+  // The id is the key of the location
+  EXPECT_EQ(computeLocationKey("test_0.cpp", "max", 2, 7, "m", 0), first);
+  IdType second = ids.assign("test_0.cpp", "max", 2, 7, "m", 1, collided);
+  EXPECT_FALSE(collided);
+  EXPECT_NE(first, second);
+  // The same location mutated twice is probed linearly
+  IdType probed = ids.assign("test_0.cpp", "max", 2, 7, "m", 0, collided);
+  EXPECT_TRUE(collided);
+  EXPECT_EQ(first + 1, probed);
+  // The id doesn't depend on the other mutations
+  LocationIdMap alone;
+  EXPECT_EQ(second,
+            alone.assign("test_0.cpp", "max", 2, 7, "m", 1, collided));
+  EXPECT_FALSE(collided);
+
+  // The map is sorted by key, with the dense index of each mutant
+  ::llvm::SmallString<128> mapPath;
+  ASSERT_FALSE(
+      ::llvm::sys::fs::createTemporaryFile("chimera-ids", "csv", mapPath));
+  ASSERT_TRUE(ids.write(mapPath.str().str()));
+  ::std::string map;
+  ASSERT_TRUE(readFile(mapPath.str().str(), map));
+  ::llvm::sys::fs::remove(mapPath);
+  ::llvm::SmallVector<::llvm::StringRef, 4> rows;
+  ::llvm::StringRef(map).split(rows, '\n', -1, false);
+  ASSERT_EQ(ids.size() + 1, rows.size());
+  ::llvm::StringRef previousKey;
+  for (unsigned i = 1; i < rows.size(); ++i) {
+    ::llvm::SmallVector<::llvm::StringRef, 8> fields;
+    rows[i].split(fields, ',');
+    ASSERT_EQ(8u, fields.size()) << rows[i].str();
+    EXPECT_EQ(to_string(i), fields[0].str());
+    EXPECT_LE(previousKey, fields[2]) << rows[i].str();
+    previousKey = fields[2];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Shard merge tests
+
+/// @brief Write a whole file
+/// @return If the file is written
+static bool writeFile(const ::std::string &path, const ::std::string &content) {
+  ::std::error_code error;
+  ::llvm::raw_fd_ostream file(path, error, ::llvm::sys::fs::F_None);
+  if (error) {
+    return false;
+  }
+  file << content;
+  file.close();
+  return !file.has_error();
+}
+
+/// @brief Write the outputs of a shard: report, ids and storage
+/// @param mutants The mutants of the shard, by the line of their location
+/// @param stored Add the stored mutants, by id
+/// @param reportRows Add the report rows of the stored mutants, by id
+static void writeShard(StorageFormat format,
+                       const ::std::string &shardDirectory,
+                       const ::std::string &filename,
+                       const ::std::string &original,
+                       const ::std::map<unsigned, ::std::string> &mutants,
+                       ::std::map<IdType, ::std::string> &stored,
+                       ::std::map<IdType, ::std::string> &reportRows) {
+  ASSERT_TRUE(createDirectories(shardDirectory));
+  LocationIdMap ids;
+  ::std::string report;
+  {
+    // The storage is complete once destroyed
+    ::std::unique_ptr<MutantStorage> storage(
+        createStorage(format, shardDirectory, filename, original, false));
+    for (const auto &mutant : mutants) {
+      bool collided;
+      IdType id = ids.assign(filename, "f", mutant.first, 1, "m", 0, collided);
+      ASSERT_FALSE(collided);
+      ASSERT_TRUE(storage->store(id, mutant.second));
+      ::std::string row =
+          to_string(id) + ",f," + to_string(mutant.first) + ",1,m,0\n";
+      report += row;
+      reportRows[id] = row;
+      stored[id] = mutant.second;
+    }
+  }
+  ASSERT_TRUE(writeFile(shardDirectory + "report.csv", report));
+  ASSERT_TRUE(ids.write(shardDirectory + LocationIdMap::mapFileName));
+}
+
+void chimera::testing::testShardMerge(StorageFormat format) {
+  ::std::string targetPath;
+  ::std::string original;
+  ::std::map<IdType, ::std::string> mutants;
+  ASSERT_TRUE(loadStorageFixture(0, targetPath, original, mutants))
+      << "No storage fixture found";
+  ::llvm::SmallString<128> tempDirectory;
+  ASSERT_FALSE(
+      ::llvm::sys::fs::createUniqueDirectory("chimera-merge", tempDirectory));
+  ::std::string root = tempDirectory.str().str() + pathSep;
+  ::std::string filename = "test_0.cpp";
+
+  // The mutants are split in two shards, by the parity of their number
+  ::std::vector<::std::string> shards;
+  ::std::map<IdType, ::std::string> stored;
+  ::std::map<IdType, ::std::string> reportRows;
+  for (unsigned s = 0; s < 2; ++s) {
+    ::std::map<unsigned, ::std::string> shardMutants;
+    for (const auto &mutant : mutants) {
+      if (mutant.first % 2 == s) {
+        shardMutants[mutant.first] = mutant.second;
+      }
+    }
+    shards.push_back(root + getShardDirectoryName(s, 2) + pathSep);
+    ASSERT_NO_FATAL_FAILURE(writeShard(format, shards.back(), filename,
+                                       original, shardMutants, stored,
+                                       reportRows));
+  }
+  ASSERT_EQ(mutants.size(), stored.size()) << "Mutant ids taken twice";
+
+  LOG_TEST_("Merging the shards of " + targetPath);
+  ::std::string mergedDirectory = root + "mutants" + pathSep;
+  ASSERT_TRUE(mergeShards(shards, mergedDirectory, filename));
+  MutantExtractor extractor;
+  ASSERT_TRUE(extractor.open(mergedDirectory, filename));
+  EXPECT_EQ(format, extractor.getFormat());
+  ::std::string expectedReport;
+  for (const auto &mutant : stored) {
+    ::std::string code;
+    ASSERT_TRUE(extractor.read(mutant.first, code))
+        << "Mutant " << mutant.first << " not merged";
+    EXPECT_EQ(mutant.second, code) << "Mutant " << mutant.first;
+    expectedReport += reportRows[mutant.first];
+  }
+  // The report is sorted by id
+  ::std::string report;
+  ASSERT_TRUE(readFile(mergedDirectory + "report.csv", report));
+  EXPECT_EQ(expectedReport, report);
+  ::std::string idMap;
+  ASSERT_TRUE(readFile(mergedDirectory + LocationIdMap::mapFileName, idMap));
+  EXPECT_EQ(stored.size() + 1,
+            (size_t)::std::count(idMap.begin(), idMap.end(), '\n'));
+
+  // A shard taking an id of another one stops the merge before any write
+  LOG_TEST_("Merging the shards of " + targetPath + " with an id conflict");
+  ::std::map<unsigned, ::std::string> conflicting{
+      {unsigned(mutants.begin()->first), mutants.begin()->second}};
+  ::std::map<IdType, ::std::string> conflictingStored;
+  ::std::map<IdType, ::std::string> conflictingRows;
+  shards.push_back(root + "conflict" + pathSep);
+  ASSERT_NO_FATAL_FAILURE(writeShard(format, shards.back(), filename, original,
+                                     conflicting, conflictingStored,
+                                     conflictingRows));
+  ::std::string conflictDirectory = root + "conflict-mutants" + pathSep;
+  EXPECT_FALSE(mergeShards(shards, conflictDirectory, filename));
+  EXPECT_FALSE(::llvm::sys::fs::exists(conflictDirectory));
+  deleteDirectory(tempDirectory);
+}
+
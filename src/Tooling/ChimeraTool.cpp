@@ -24,18 +24,34 @@
 //===----------------------------------------------------------------------===//
 
 #include "Log.h"
+#include "Core/MetadataStore.h"
+#include "Core/MutantSink.h"
 #include "Core/MutationTemplate.h"
+#include "Core/ShardMerge.h"
 #include "Testing/ChimeraTest.h"
 #include "Tooling/ChimeraTool.h"
 #include "Tooling/CompilationDatabaseUtils.h"
+#include "Tooling/Coordinator.h"
 #include "Tooling/FrontendActions.h"
+#include "Tooling/ValidationCache.h"
 
 #include "clang/Tooling/CommonOptionsParser.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 using namespace chimera;
@@ -102,6 +118,164 @@ enum PreprocessLevel {
     ::llvm::cl::desc("Disable the generation of the report"),
     ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
     ::llvm::cl::init(false));
+::llvm::cl::opt<bool> optBinaryReport(
+    "binary-report",
+    ::llvm::cl::desc("Write also report.bin, a binary columnar report with "
+                     "string tables for functions and mutators"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<bool> optMetadataStore(
+    "metadata-store",
+    ::llvm::cl::desc("Keep the metadata of the operators in a single store "
+                     "for the run, <output_dir>/metadata.archive, instead of "
+                     "a report per mutant"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<::chimera::mutant::IdScheme> optIdScheme(
+    "id-scheme", ::llvm::cl::desc("How the mutant ids are assigned"),
+    ::llvm::cl::values(
+        clEnumValN(::chimera::mutant::SequentialIds, "sequential",
+                   "In order of generation, the default"),
+        clEnumValN(::chimera::mutant::LocationIds, "location",
+                   "Derived from file, function, location, mutator and "
+                   "type, with the map in ids.csv"),
+        clEnumValEnd),
+    ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(::chimera::mutant::SequentialIds));
+::llvm::cl::opt<::std::string> optShard(
+    "shard",
+    ::llvm::cl::desc("Generate only the shard i, 0 <= i < N, of the mutation "
+                     "sites, in <output_dir>/shard-<i>-of-<N>/, with the "
+                     "location ids. The N shards can run anywhere on the "
+                     "same sources, then -merge-reports joins them"),
+    ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("i/N"),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
+::llvm::cl::opt<::std::string> optCoordinator(
+    "coordinator",
+    ::llvm::cl::desc("Don't mutate the sources, hand out their functions to "
+                     "the workers connected to this TCP address, then merge "
+                     "their outputs in <output_dir>/mutants/. The HOM "
+                     "operators are handed out whole. The workers must see "
+                     "the sources at the same paths"),
+    ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("[host:]port"),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
+::llvm::cl::opt<::std::string> optWorker(
+    "worker",
+    ::llvm::cl::desc("Mutate the functions handed out by the coordinator at "
+                     "this TCP address, with the other options, using "
+                     "<output_dir> as scratch. This option disables the "
+                     "source input."),
+    ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("host:port"),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
+::llvm::cl::opt<::chimera::mutant::StorageFormat> optOutputFormat(
+    "output-format", ::llvm::cl::desc("How the generated mutants are stored"),
+    ::llvm::cl::values(
+        clEnumValN(::chimera::mutant::FilesStorage, "files",
+                   "A full copy of the source file per mutant"),
+        clEnumValN(::chimera::mutant::PatchStorage, "patch",
+                   "The source file once, plus the edits of each mutant "
+                   "in mutants.patch"),
+        clEnumValN(::chimera::mutant::ArchiveStorage, "archive",
+                   "All the mutants in the indexed mutants.archive"),
+        clEnumValEnd),
+    ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(::chimera::mutant::FilesStorage));
+::llvm::cl::opt<bool> optCompress(
+    "compress",
+    ::llvm::cl::desc("Compress the mutants and the report with zlib: gzip "
+                     "files, or a compressed stream per mutant in the "
+                     "archive"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<::std::string> optStreamMutants(
+    "stream-mutants",
+    ::llvm::cl::desc("Stream the mutants, as soon as they are validated, to "
+                     "the standard output (-) or to a local socket, as "
+                     "length-prefixed records, instead of storing them. The "
+                     "log goes to the standard error."),
+    ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("-|socket-path"),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
+::llvm::cl::opt<unsigned> optOutputQueue(
+    "output-queue",
+    ::llvm::cl::desc("Number of writes of mutants and reports that can wait "
+                     "for the writer thread, 0 writes them synchronously. "
+                     "Default: 256"),
+    ::llvm::cl::value_desc("N"), ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(256));
+::llvm::cl::opt<ValidationMode> optValidationMode(
+    "validation", ::llvm::cl::desc("How the mutants are syntax checked"),
+    ::llvm::cl::values(
+        clEnumValN(OnDiskValidation, "disk",
+                   "Write each mutant in a temp file and check it "
+                   "(default)"),
+        clEnumValN(InMemoryValidation, "memory",
+                   "Overlay each mutant on the source file, in memory"),
+        clEnumValEnd),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(OnDiskValidation));
+::llvm::cl::opt<bool> optValidationPreamble(
+    "validation-preamble",
+    ::llvm::cl::desc("Precompile the preamble of each source file once and "
+                     "reuse it for all its in-memory mutant checks"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<bool> optNoValidationPrefilter(
+    "no-validation-prefilter",
+    ::llvm::cl::desc("Disable the lexical filter that rejects the mutants "
+                     "with unbalanced brackets or quotes before the syntax "
+                     "check"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<bool> optNoValidationAST(
+    "no-validation-ast",
+    ::llvm::cl::desc("Disable the validation of the operator replacements on "
+                     "the AST, without a reparse"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<bool> optNoDedup(
+    "no-dedup",
+    ::llvm::cl::desc("Disable the deduplication of the mutants: a mutant "
+                     "equal to a previous one is reported as its alias, "
+                     "without checking and saving it again"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<bool> optParanoid(
+    "paranoid",
+    ::llvm::cl::desc("Syntax check also the mutants that the mutators declare "
+                     "syntax safe or that the AST validation decides"),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+::llvm::cl::opt<unsigned> optJobs(
+    "j",
+    ::llvm::cl::desc("Number of source files processed concurrently, 0 for "
+                     "one per core. The compile commands must run in the "
+                     "current directory. Default: 1"),
+    ::llvm::cl::value_desc("N"), ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(1));
+::llvm::cl::opt<unsigned> optValidationJobs(
+    "validation-jobs",
+    ::llvm::cl::desc("Number of threads that check the mutants of a source, "
+                     "with -validation=memory"),
+    ::llvm::cl::value_desc("N"), ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(1));
+::llvm::cl::opt<unsigned> optValidationBatch(
+    "validation-batch",
+    ::llvm::cl::desc("Number of mutants of function bodies checked in a "
+                     "single in-memory parse, as clones of the functions. "
+                     "Default: 1, no batches"),
+    ::llvm::cl::value_desc("N"), ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(1));
+::llvm::cl::opt<::std::string> optValidationCache(
+    "validation-cache",
+    ::llvm::cl::desc("Directory of a persistent cache of the mutant checks "
+                     "verdicts"),
+    ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("dir-path"),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
+::llvm::cl::opt<unsigned> optValidationCacheSize(
+    "validation-cache-size",
+    ::llvm::cl::desc("Max number of verdicts in the validation cache, the "
+                     "least recently used are evicted. Default: 262144"),
+    ::llvm::cl::value_desc("entries"), ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(262144));
 ::llvm::cl::opt<::std::string> optFunOpConfFile(
     "fun-op", ::llvm::cl::desc(
                   "The configuration file for functions/operations filtering"),
@@ -122,10 +296,33 @@ enum PreprocessLevel {
 ::llvm::cl::opt<::std::string> optExecuteTest(
     "execute-test",
     ::llvm::cl::desc("Execute tests. This option disables the source input, "
-                     "only other options will be accepted. The test directory should contains directories named as the identifier of the mutators to test."),
+                     "only other options will be accepted. The test directory should contains directories named as the identifier of the mutators to test, "
+                     "the storage fixtures are in the directory storage next to it."),
     ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("test-dir"),
     ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
 
+::llvm::cl::opt<::std::string> optExtract(
+    "extract",
+    ::llvm::cl::desc("Extract the given mutants, in <output_dir>/<id>/, from "
+                     "the target output directory given by -extract-from, "
+                     "without parsing. This option disables the source input."),
+    ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("id[,id...]"),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
+::llvm::cl::opt<::std::string> optExtractFrom(
+    "extract-from",
+    ::llvm::cl::desc("The target output directory of -extract, "
+                     "<output_dir>/mutants/<source_filename>/ of a previous "
+                     "run"),
+    ::llvm::cl::ValueRequired, ::llvm::cl::value_desc("dir-path"),
+    ::llvm::cl::cat(catChimera), ::llvm::cl::init(""));
+::llvm::cl::opt<bool> optMergeReports(
+    "merge-reports",
+    ::llvm::cl::desc("Merge the shards in <output_dir>/shard-*/ in "
+                     "<output_dir>/mutants/, without parsing. This option "
+                     "disables the source input."),
+    ::llvm::cl::ValueDisallowed, ::llvm::cl::cat(catChimera),
+    ::llvm::cl::init(false));
+
 ::llvm::cl::opt<bool>
     optShowOperators("show-op",
                      ::llvm::cl::desc("Show the supported Mutation Operators"),
@@ -141,6 +338,333 @@ bool optIsOccured(const ::std::string &optString, int argc, const char **argv) {
   }
   return false;
 }
+
+/// @brief Extract the mutants in optExtract from the storage in optExtractFrom
+/// @return 0 if all the mutants are extracted
+int extractMutants() {
+  ::std::string storageDir =
+      clang::tooling::getAbsolutePath((::std::string)optExtractFrom);
+  while (storageDir.size() > 1 && storageDir.back() == chimera::fs::pathSep) {
+    storageDir.pop_back();
+  }
+  // The target output directory is named as the target
+  ::std::string filename = ::llvm::sys::path::filename(storageDir);
+  storageDir += chimera::fs::pathSep;
+  ::chimera::mutant::MutantExtractor extractor;
+  if (optExtractFrom == "" || !extractor.open(storageDir, filename)) {
+    chimera::log::ChimeraLogger::error("Couldn't open the mutants in " +
+                                       storageDir);
+    return 1;
+  }
+  ::std::string outputPath =
+      clang::tooling::getAbsolutePath((::std::string)optOutputDir) +
+      chimera::fs::pathSep;
+  int retval = 0;
+  ::llvm::SmallVector<::llvm::StringRef, 16> ids;
+  ::llvm::StringRef(optExtract).split(ids, ',', -1, false);
+  for (::llvm::StringRef idString : ids) {
+    ::chimera::mutant::IdType id;
+    ::std::string code;
+    if (idString.trim().getAsInteger(10, id) || !extractor.read(id, code)) {
+      chimera::log::ChimeraLogger::error("Couldn't extract the mutant " +
+                                         idString.str());
+      retval = 1;
+      continue;
+    }
+    ::std::string mutantDir =
+        outputPath + ::std::to_string(id) + chimera::fs::pathSep;
+    ::std::error_code error;
+    if (chimera::fs::createDirectories(mutantDir)) {
+      ::llvm::raw_fd_ostream file(mutantDir + filename, error,
+                                  ::llvm::sys::fs::F_None);
+      if (!error) {
+        file << code;
+      }
+    }
+    if (error || !::llvm::sys::fs::exists(mutantDir + filename)) {
+      chimera::log::ChimeraLogger::error("Couldn't write the mutant " +
+                                         idString.str());
+      retval = 1;
+    }
+  }
+  return retval;
+}
+
+/// @brief Merge the outputs of the shards in optOutputDir
+/// @return 0 if all the targets are merged
+int mergeShardOutputs() {
+  ::std::string outputPath =
+      clang::tooling::getAbsolutePath((::std::string)optOutputDir) +
+      chimera::fs::pathSep;
+  ::std::vector<::std::string> shards;
+  ::std::error_code error;
+  for (::llvm::sys::fs::directory_iterator dir(outputPath, error), end;
+       !error && dir != end; dir.increment(error)) {
+    if (::llvm::sys::path::filename(dir->path()).startswith("shard-") &&
+        ::llvm::sys::fs::is_directory(dir->path())) {
+      shards.push_back(dir->path());
+    }
+  }
+  ::std::sort(shards.begin(), shards.end());
+  // The target output directories of each target, from all the shards
+  ::std::map<::std::string, ::std::vector<::std::string>> targets;
+  for (const ::std::string &shard : shards) {
+    for (::llvm::sys::fs::directory_iterator
+             dir(shard + chimera::fs::pathSep + "mutants", error),
+         end;
+         !error && dir != end; dir.increment(error)) {
+      if (::llvm::sys::fs::is_directory(dir->path())) {
+        targets[::llvm::sys::path::filename(dir->path()).str()].push_back(
+            dir->path() + chimera::fs::pathSep);
+      }
+    }
+  }
+  if (targets.empty()) {
+    chimera::log::ChimeraLogger::error("No shard outputs in " + outputPath);
+    return 1;
+  }
+  int retval = 0;
+  for (::std::string &shard : shards) {
+    shard += chimera::fs::pathSep;
+  }
+  if (!::chimera::mutant::mergeMetadataStores(shards, outputPath)) {
+    retval = 1;
+  }
+  for (const auto &target : targets) {
+    if (!::chimera::mutant::mergeShards(
+            target.second, outputPath + "mutants" + chimera::fs::pathSep +
+                               target.first + chimera::fs::pathSep,
+            target.first)) {
+      chimera::log::ChimeraLogger::error("Couldn't merge the shards of " +
+                                         target.first);
+      retval = 1;
+    }
+  }
+  chimera::log::ChimeraLogger::info(
+      "Merged " + ::std::to_string(targets.size()) + " targets from " +
+      ::std::to_string(shards.size()) + " shards");
+  return retval;
+}
+
+/// @brief Create the validation cache, if enabled
+::std::unique_ptr<ValidationCache> createValidationCache() {
+  ::std::unique_ptr<ValidationCache> validationCache;
+  if (optValidationCache != "") {
+    ::std::string cacheDir =
+        clang::tooling::getAbsolutePath((::std::string)optValidationCache);
+    if (::chimera::fs::createDirectories(cacheDir)) {
+      validationCache.reset(
+          new ValidationCache(cacheDir, optValidationCacheSize));
+    } else {
+      chimera::log::ChimeraLogger::warning(
+          "Couldn't create the validation cache directory, cache disabled");
+    }
+  }
+  return validationCache;
+}
+
+/// @brief Check if the sources can be parsed concurrently
+/// @details Each ClangTool::run changes the working directory of the process
+///          to the directory of its compile command, and restores it at the
+///          end. Concurrent runs are safe only when all the compile commands
+///          run in the current working directory.
+/// @param index The compile commands of the sources
+/// @param sourcePaths The sources
+/// @return If all the compile commands run in the current working directory
+bool isConcurrentSafe(::chimera::cd_utils::CompileCommandIndex &index,
+                      const ::std::vector<::std::string> &sourcePaths) {
+  ::llvm::SmallString<256> workingDirectory;
+  if (::llvm::sys::fs::current_path(workingDirectory)) {
+    return false;
+  }
+  for (const ::std::string &sourcePath : sourcePaths) {
+    for (const auto &command : index.getCompileCommands(sourcePath)) {
+      bool equivalent = false;
+      if (::llvm::sys::fs::equivalent(command.Directory, workingDirectory,
+                                      equivalent) ||
+          !equivalent) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// @brief Create the metadata store of the run, if enabled
+::std::unique_ptr<::chimera::mutant::RunMetadataStore> createMetadataStore() {
+  ::std::unique_ptr<::chimera::mutant::RunMetadataStore> metadataStore;
+  if (optMetadataStore && optGenerateMutants) {
+    metadataStore.reset(new ::chimera::mutant::RunMetadataStore());
+  }
+  return metadataStore;
+}
+
+/// @brief Write the metadata store of the run, if not empty
+/// @param outputPath The output directory, with the trailing path separator
+/// @return If it is written
+bool writeMetadataStore(const ::chimera::mutant::RunMetadataStore *store,
+                        const ::std::string &outputPath) {
+  if (store == nullptr || store->empty()) {
+    return true;
+  }
+  if (!::chimera::fs::createDirectories(outputPath) ||
+      !store->write(outputPath +
+                    ::chimera::mutant::RunMetadataStore::storeFileName)) {
+    chimera::log::ChimeraLogger::error("Couldn't write the metadata store in " +
+                                       outputPath);
+    return false;
+  }
+  return true;
+}
+
+/// @brief Open the stream of the mutants, if enabled
+::std::unique_ptr<::chimera::mutant::StreamMutantSink> openMutantStream() {
+  ::std::unique_ptr<::chimera::mutant::StreamMutantSink> stream;
+  if (optStreamMutants != "" && optGenerateMutants) {
+    stream = optStreamMutants == "-"
+                 ? ::chimera::mutant::StreamMutantSink::openStdout()
+                 : ::chimera::mutant::StreamMutantSink::openSocket(
+                       optStreamMutants);
+    if (!stream) {
+      chimera::log::ChimeraLogger::warning(
+          "Couldn't stream the mutants to " + (::std::string)optStreamMutants +
+          ", storing them");
+    }
+  }
+  return stream;
+}
+
+/// @brief Set the options of the command line on a mutation template
+void setTemplateOptions(chimera::MutationTemplate &t,
+                        ValidationCache *validationCache,
+                        ::chimera::mutant::RunMetadataStore *metadataStore,
+                        ::chimera::mutant::MutantSink *mutantStream) {
+  // Set if generate the mutatns or only the report
+  t.setGenerateMutants(optGenerateMutants);
+  t.setGenerateMutantsReport(!optNotGenerateReport);
+  t.setGenerateBinaryReport(optBinaryReport);
+  t.setRunMetadataStore(metadataStore);
+  t.setStorageFormat(optOutputFormat);
+  t.setCompressOutput(optCompress);
+  t.setOutputQueueSize(optOutputQueue);
+  t.setMutantStream(mutantStream);
+  t.setValidationMode(optValidationMode);
+  t.setUsePreamble(optValidationPreamble);
+  t.setValidationJobs(optValidationJobs);
+  t.setValidationBatch(optValidationBatch);
+  t.setUsePrefilter(!optNoValidationPrefilter);
+  t.setParanoid(optParanoid);
+  t.setUseOperatorValidator(!optNoValidationAST);
+  t.setDeduplicate(!optNoDedup);
+  // The outputs of the shards and of the workers are merged by location
+  t.setIdScheme(optShard != "" || optWorker != ""
+                    ? ::chimera::mutant::LocationIds
+                    : (::chimera::mutant::IdScheme)optIdScheme);
+  t.setValidationCache(validationCache);
+}
+
+/// @brief Check if the mutants of an operator span the functions: the HOM
+/// operators and the FOM ones with HOM mutators
+bool isSpanningFunctions(const ::chimera::m_operator::MutationOperator &op) {
+  if (op.isHom()) {
+    return true;
+  }
+  for (const auto &mutator : op.getMutators()) {
+    if (mutator->isHom()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// @brief Queue the work units of a source
+/// @details The operators whose mutants span the functions, as FLAP and VPA,
+///          get a unit each with all their functions, so that their mutants
+///          and operation ids are the ones of a local run. The others get a
+///          unit per function defined in the source.
+void queueWorkUnits(::chimera::distributed::Coordinator &coordinator,
+                    const ::clang::tooling::CompileCommand &command,
+                    const ::std::string &sourcePath,
+                    const conf::FunOpConfMap &confMap,
+                    const chimera::MutationOperatorPtrMap &operators) {
+  ::chimera::distributed::WorkUnit unit;
+  unit.sourcePath = sourcePath;
+  unit.directory = command.Directory;
+  unit.commandLine = command.CommandLine;
+  // The operators of each function, as the template takes them: the row of
+  // all the functions hides the others
+  conf::FunOpConfMap functionOperators = confMap;
+  auto allFunctions = confMap.find("CHIMERA_ALL_FUNCTIONS");
+  if (confMap.empty()) {
+    functionOperators["CHIMERA_ALL_FUNCTIONS"].push_back(
+        "CHIMERA_ALL_OPERATORS");
+  } else if (allFunctions != confMap.end()) {
+    functionOperators = conf::FunOpConfMap{*allFunctions};
+  }
+  // Split the operators among the functions and the spanning ones
+  conf::FunOpConfMap fomOperators;
+  ::std::map<::std::string, ::std::vector<::std::string>> spanningFunctions;
+  for (const auto &row : functionOperators) {
+    bool allOperators =
+        ::std::find(row.second.begin(), row.second.end(),
+                    "CHIMERA_ALL_OPERATORS") != row.second.end();
+    for (const auto &op : operators) {
+      if (!allOperators && ::std::find(row.second.begin(), row.second.end(),
+                                       op.first) == row.second.end()) {
+        continue;
+      }
+      if (isSpanningFunctions(*op.second)) {
+        spanningFunctions[op.first].push_back(row.first);
+      } else {
+        fomOperators[row.first].push_back(op.first);
+      }
+    }
+  }
+  for (const auto &spanning : spanningFunctions) {
+    unit.operators = {spanning.first};
+    unit.functions = spanning.second;
+    if (unit.functions.front() == "CHIMERA_ALL_FUNCTIONS") {
+      unit.functions.clear();
+    }
+    coordinator.addUnit(unit);
+  }
+  allFunctions = fomOperators.find("CHIMERA_ALL_FUNCTIONS");
+  if (allFunctions == fomOperators.end()) {
+    // Only the configured functions
+    for (const auto &row : fomOperators) {
+      unit.functions = {row.first};
+      unit.operators = row.second;
+      coordinator.addUnit(unit);
+    }
+    return;
+  }
+  unit.operators = allFunctions->second;
+  // The definitions are listed as "<name> at <file>:<line>:<column>", the
+  // ones of the included files don't change the source
+  ::std::string definitions;
+  ::llvm::raw_string_ostream definitionsStream(definitions);
+  ::chimera::functionDefAction(definitionsStream, command, sourcePath);
+  definitionsStream.flush();
+  ::llvm::SmallVector<::llvm::StringRef, 64> lines;
+  ::llvm::StringRef(definitions).split(lines, '\n', -1, false);
+  ::std::set<::std::string> functions;
+  for (::llvm::StringRef line : lines) {
+    ::llvm::StringRef name, location;
+    ::std::tie(name, location) = line.split(" at ");
+    if (!name.empty() && location.startswith(sourcePath + ":")) {
+      functions.insert(name.str());
+    }
+  }
+  unit.functions.clear();
+  if (functions.empty()) {
+    // A single unit for the whole source
+    coordinator.addUnit(unit);
+  }
+  for (const ::std::string &function : functions) {
+    unit.functions = {function};
+    coordinator.addUnit(unit);
+  }
+}
 /// \}
 
 bool chimera::ChimeraTool::registerMutationOperator(
@@ -153,8 +677,20 @@ bool chimera::ChimeraTool::registerMutationOperator(
   return retval.second;
 }
 
+bool chimera::ChimeraTool::registerMutationOperator(
+    MutationOperatorFactory factory) {
+  m_operator::MutationOperatorPtr op = factory();
+  m_operator::IdType id = op->getIdentifier();
+  if (!this->registerMutationOperator(::std::move(op))) {
+    return false;
+  }
+  this->operatorFactoryMap[id] = ::std::move(factory);
+  return true;
+}
+
 bool chimera::ChimeraTool::unregisterMutationOperator(
     const m_operator::IdType &id) {
+  this->operatorFactoryMap.erase(id);
   return this->registeredOperatorMap.erase(id);
 }
 
@@ -198,6 +734,63 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
     o.verbose = optVerbose;
     return ::chimera::testing::runAllTest(argc, argv, optExecuteTest, o);
   }
+  if (optIsOccured(optExtract.ArgStr, argc, argv)) {
+    // The mutants are read back from the storage, nothing is parsed
+    llvm::cl::ParseCommandLineOptions(argc, argv, overview);
+    return extractMutants();
+  }
+  if (optIsOccured(optMergeReports.ArgStr, argc, argv)) {
+    // The shards are merged from their outputs, nothing is parsed
+    llvm::cl::ParseCommandLineOptions(argc, argv, overview);
+    return mergeShardOutputs();
+  }
+  if (optIsOccured(optWorker.ArgStr, argc, argv)) {
+    // The sources and their compile commands come from the coordinator
+    llvm::cl::ParseCommandLineOptions(argc, argv, overview);
+    if (optVerbose) {
+      chimera::log::ChimeraLogger::initVerbose();
+      chimera::log::ChimeraLogger::setVerboseLevel(9);
+    }
+    ::std::unique_ptr<ValidationCache> validationCache =
+        createValidationCache();
+    ::std::unique_ptr<::chimera::mutant::StreamMutantSink> mutantStream =
+        openMutantStream();
+    bool done = ::chimera::distributed::runWorker(
+        optWorker,
+        clang::tooling::getAbsolutePath((::std::string)optOutputDir) +
+            chimera::fs::pathSep,
+        [&](const ::chimera::distributed::WorkUnit &unit,
+            const ::std::string &outputDirectory) {
+          ::clang::tooling::CompileCommand command;
+          command.Directory = unit.directory;
+          command.CommandLine = unit.commandLine;
+          chimera::MutationTemplate t(command, unit.sourcePath,
+                                      outputDirectory);
+          for (auto it = this->registeredOperatorMap.begin();
+               it != this->registeredOperatorMap.end(); ++it) {
+            t.loadOperator(it->second.get());
+          }
+          // The metadata of the unit are sent with its outputs
+          ::std::unique_ptr<::chimera::mutant::RunMetadataStore>
+              metadataStore = createMetadataStore();
+          setTemplateOptions(t, validationCache.get(), metadataStore.get(),
+                             mutantStream.get());
+          conf::FunOpConfMap map;
+          if (unit.functions.empty()) {
+            map["CHIMERA_ALL_FUNCTIONS"] = unit.operators;
+          }
+          for (const ::std::string &function : unit.functions) {
+            map[function] = unit.operators;
+          }
+          return t.analyze(map) == 0 &&
+                 writeMetadataStore(metadataStore.get(),
+                                    t.getTargetOutputDirectory());
+        });
+    if (validationCache) {
+      validationCache->flush();
+    }
+    return done ? 0 : 1;
+  }
   ///////////////////////////////////////////////////////////////////////////////
   // From now on the source input is required
   const char **argvv;
@@ -257,6 +850,29 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
   std::string outputPath =
       clang::tooling::getAbsolutePath((::std::string)optOutputDir);
 
+  // Each shard writes in its own output directory
+  unsigned shardIndex = 0, shardCount = 1;
+  if (optShard != "") {
+    ::llvm::StringRef index, count;
+    ::std::tie(index, count) = ::llvm::StringRef(optShard).split('/');
+    if (index.getAsInteger(10, shardIndex) ||
+        count.getAsInteger(10, shardCount) || shardCount == 0 ||
+        shardIndex >= shardCount) {
+      chimera::log::ChimeraLogger::error("Invalid shard " +
+                                         (::std::string)optShard +
+                                         ", expected i/N with 0 <= i < N");
+      return 1;
+    }
+    if (optIdScheme.getNumOccurrences() > 0 &&
+        optIdScheme == ::chimera::mutant::SequentialIds) {
+      chimera::log::ChimeraLogger::warning(
+          "The shards need the location ids, -id-scheme ignored");
+    }
+    outputPath += chimera::fs::pathSep +
+                  ::chimera::mutant::getShardDirectoryName(shardIndex,
+                                                           shardCount);
+  }
+
   // Set resources directory
   std::string resourcesOutputDir =
       outputPath + chimera::fs::pathSep + "resources" + chimera::fs::pathSep;
@@ -289,6 +905,28 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
     }
   }
 
+  // Validation cache, shared by all the source files
+  ::std::unique_ptr<ValidationCache> validationCache = createValidationCache();
+  // Metadata store, shared by all the source files
+  ::std::unique_ptr<::chimera::mutant::RunMetadataStore> metadataStore =
+      createMetadataStore();
+  // Stream of the mutants, shared by all the source files
+  ::std::unique_ptr<::chimera::mutant::StreamMutantSink> mutantStream;
+  if (optCoordinator == "") {
+    mutantStream = openMutantStream();
+  }
+
+  // The coordinator listens before the sources are listed, the workers can
+  // start with it
+  ::std::unique_ptr<::chimera::distributed::Coordinator> coordinator;
+  if (optCoordinator != "") {
+    coordinator.reset(new ::chimera::distributed::Coordinator(
+        outputPath + chimera::fs::pathSep + "units" + chimera::fs::pathSep));
+    if (!coordinator->listen(optCoordinator)) {
+      return 1;
+    }
+  }
+
   // To avoid problems of directory changing during clang operations create a
   // sourceAbsolutePathList
   std::vector<std::string> sourceAbsolutePathList;
@@ -297,19 +935,24 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
         clang::tooling::getAbsolutePath(sourcePath));
   }
 
-  // Loop on SourcePaths
-  ::std::vector<::std::string> sourcePaths = op.getSourcePathList();
-  for (std::string sourcePath : sourceAbsolutePathList) {
+  // The files of the compilation database are indexed once, for all the
+  // sources. The previous error check make safe the user database.
+  ::chimera::cd_utils::CompileCommandIndex compileCommandIndex(
+      optCompilationDatabaseDir != "" ? *userCDatabase
+                                      : op.getCompilations());
+
+  // Process a source with a set of operators, return if the next sources
+  // are processed, setting retval otherwise
+  ::std::mutex databaseMutex;
+  auto processSource = [&](std::string sourcePath,
+                           const chimera::MutationOperatorPtrMap &operators,
+                           int &retval) -> bool {
     // Get the compile commands for the sourcePath
     ::chimera::cd_utils::CompileCommandVector commands;
-    if (optCompilationDatabaseDir != "") {
-      // The previous error check make safe this instruction
-      commands = chimera::cd_utils::getCompileCommandsByFilePath(*userCDatabase,
-                                                                 sourcePath);
-    } else {
-      commands = chimera::cd_utils::getCompileCommandsByFilePath(
-          op.getCompilations(), sourcePath);
-    }
+    // The databases aren't meant to be shared
+    ::std::unique_lock<::std::mutex> databaseLock(databaseMutex);
+    commands = compileCommandIndex.getCompileCommands(sourcePath);
+    databaseLock.unlock();
 #ifdef _CHIEMERA_DEBUG_
     ::chimera::cd_utils::dump(::std::cout, commands);
 #endif
@@ -317,7 +960,7 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
     if (commands.empty()) {
       chimera::log::ChimeraLogger::warning(
           "Compile command not found. Skipping " + sourcePath);
-      continue; // Skip this iteration
+      return true; // Skip this source
     }
 
     // Prepare inputs for the MutationTemplate
@@ -395,7 +1038,8 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
               "comments, see the the first error message, if this is the case, "
               "modify the source file in order to use this option.\nSorry for "
               "the inconvenient.");
-          return 1;
+          retval = 1;
+          return false;
         } else {
           chimera::log::ChimeraLogger::verbose(
               "[ PASS ] Performing syntax check on preprocessed file");
@@ -404,7 +1048,8 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
       } else {
         chimera::log::ChimeraLogger::fatal(
             "Could not create the resources directory.");
-        return 1; // Error
+        retval = 1; // Error
+        return false;
       }
     }
 
@@ -412,7 +1057,13 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
     /// The command for this source file is ready, can perform FrontendAction
     if (optShowFunDef) {
       std::cout << "Function Definitions found : " << std::endl;
-      return ::chimera::functionDefAction(llvm::outs(), command, sourcePath);
+      retval = ::chimera::functionDefAction(llvm::outs(), command, sourcePath);
+      return false;
+    }
+    if (coordinator) {
+      // The functions of the source are mutated by the workers
+      queueWorkUnits(*coordinator, command, sourcePath, confMap, operators);
+      return true;
     }
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -422,21 +1073,128 @@ int chimera::ChimeraTool::run(int argc, const char **argv) {
     chimera::MutationTemplate t(command, sourcePath,
                                 outputPath + chimera::fs::pathSep + "mutants");
 
-    // Loop on registered operators
-    const chimera::MutationOperatorPtrMap &map = this->registeredOperatorMap;
-    for (auto it = map.begin(); it != map.end(); ++it) {
+    // Loop on the operators
+    for (auto it = operators.begin(); it != operators.end(); ++it) {
       t.loadOperator(it->second.get());
     }
 
-    // Set if generate the mutatns or only the report
-    t.setGenerateMutants(optGenerateMutants);
-    t.setGenerateMutantsReport(!optNotGenerateReport);
+    setTemplateOptions(t, validationCache.get(), metadataStore.get(),
+                       mutantStream.get());
+    t.setShard(shardIndex, shardCount);
     // Analyze template
     if (optFunOpConfFile != "") {
       t.analyze(confMap);
     } else {
       t.analyze();
     }
+    return true;
+  };
+
+  // The sources are taken in order by the workers, each with its own
+  // operators since the mutators keep the state of a target
+  unsigned jobs = optJobs;
+  if (jobs == 0) {
+    jobs = ::std::max(1u, ::std::thread::hardware_concurrency());
+  }
+  jobs = ::std::min<unsigned>(jobs, sourceAbsolutePathList.size());
+  if (jobs > 1 && optShowFunDef) {
+    // It stops at the first source
+    jobs = 1;
+  }
+  if (jobs > 1 &&
+      this->operatorFactoryMap.size() != this->registeredOperatorMap.size()) {
+    chimera::log::ChimeraLogger::warning(
+        "Some operators can't be instantiated per thread, processing the "
+        "sources serially");
+    jobs = 1;
+  }
+  if (jobs > 1 &&
+      !isConcurrentSafe(compileCommandIndex, sourceAbsolutePathList)) {
+    chimera::log::ChimeraLogger::warning(
+        "The compile commands don't all run in the current directory, "
+        "processing the sources serially");
+    jobs = 1;
+  }
+  int retval = 0;
+  if (jobs <= 1) {
+    for (const std::string &sourcePath : sourceAbsolutePathList) {
+      if (!processSource(sourcePath, this->registeredOperatorMap, retval)) {
+        return retval;
+      }
+    }
+  } else {
+    chimera::log::ChimeraLogger::verbose(
+        "Processing the sources with " + ::std::to_string(jobs) + " threads");
+    ::std::atomic<::std::size_t> next(0);
+    ::std::atomic<bool> stop(false);
+    ::std::mutex retvalMutex;
+    ::std::vector<::std::thread> workers;
+    for (unsigned j = 0; j < jobs; ++j) {
+      workers.emplace_back([&]() {
+        chimera::MutationOperatorPtrMap operators;
+        for (const auto &factory : this->operatorFactoryMap) {
+          m_operator::MutationOperatorPtr o = factory.getValue()();
+          operators[o->getIdentifier()] = ::std::move(o);
+        }
+        for (::std::size_t i = next++;
+             i < sourceAbsolutePathList.size() && !stop; i = next++) {
+          int sourceRetval = 0;
+          if (!processSource(sourceAbsolutePathList[i], operators,
+                             sourceRetval)) {
+            ::std::lock_guard<::std::mutex> lock(retvalMutex);
+            if (!stop.exchange(true)) {
+              retval = sourceRetval;
+            }
+          }
+        }
+      });
+    }
+    for (::std::thread &worker : workers) {
+      worker.join();
+    }
+    if (stop) {
+      return retval;
+    }
+  }
+  if (coordinator) {
+    // The units of each source are merged as shards
+    if (!coordinator->run()) {
+      retval = 1;
+    }
+    ::std::vector<::std::string> unitDirectories;
+    for (const auto &target : coordinator->getOutputs()) {
+      unitDirectories.insert(unitDirectories.end(), target.second.begin(),
+                             target.second.end());
+      if (!::chimera::mutant::mergeShards(
+              target.second, outputPath + chimera::fs::pathSep + "mutants" +
+                                 chimera::fs::pathSep + target.first +
+                                 chimera::fs::pathSep,
+              target.first)) {
+        chimera::log::ChimeraLogger::error("Couldn't merge the units of " +
+                                           target.first);
+        retval = 1;
+      }
+    }
+    if (!::chimera::mutant::mergeMetadataStores(
+            unitDirectories, outputPath + chimera::fs::pathSep)) {
+      retval = 1;
+    }
+    if (retval == 0) {
+      chimera::fs::deleteDirectory(outputPath + chimera::fs::pathSep +
+                                   "units");
+    }
+    return retval;
+  }
+  if (validationCache) {
+    chimera::log::ChimeraLogger::verbose(
+        "Validation cache: " + ::std::to_string(validationCache->getHits()) +
+        " hits, " + ::std::to_string(validationCache->getMisses()) +
+        " misses");
+    validationCache->flush();
+  }
+  if (!writeMetadataStore(metadataStore.get(),
+                          outputPath + chimera::fs::pathSep)) {
+    return 1;
   }
   return 0;
 }
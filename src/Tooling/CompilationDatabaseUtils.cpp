@@ -30,6 +30,7 @@
 
 #include "llvm/Support/Path.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
 
 using namespace chimera::log;
@@ -68,40 +69,85 @@ void chimera::cd_utils::dump(
     dump(out, database.getAllCompileCommands());
 }
 
-chimera::cd_utils::CompileCommandVector
-chimera::cd_utils::getCompileCommandsByFilePath(
-    const CompilationDatabase &database, StringRef filename) {
-  // First search for the correct "file"
-  Twine targetFilePath = Twine(filename);
-  std::string foundFilePath;
-  ChimeraLogger::verboseAndIncr("Retrieving compileCommands for " +
-                                targetFilePath.str());
-  // Find the foundFilename to access specific compileCommands
-  // Get all "file" field of the compilation database
-  auto compileFile = database.getAllFiles();
-  // Check if it's empty
-  if (!compileFile.empty()) {
-    // This isn't a FixedCompilationDatabase
-    for (auto file = compileFile.begin(); file != compileFile.end(); ++file) {
-      // Compare with targetFilename
-      Twine filePathToCompare(*file);
-      ChimeraLogger::verbose("Comparing with File: " + *file);
-      // llvm::sys::fs::equivalent to test the really equivalence
-      if (llvm::sys::fs::equivalent(targetFilePath, filePathToCompare)) {
-        ChimeraLogger::verbose("Successful. Match found!");
-        foundFilePath = *file;
-        break;
-      }
+namespace {
+/// @brief Return the absolute path, without the dots
+std::string normalizePath(StringRef path) {
+  SmallString<256> normalized(path);
+  sys::fs::make_absolute(normalized);
+  sys::path::remove_dots(normalized, true);
+  return normalized.str().str();
+}
+} // end anonymous namespace
+
+chimera::cd_utils::CompileCommandIndex::CompileCommandIndex(
+    const CompilationDatabase &database)
+    : database(database), files(database.getAllFiles()), idsIndexed(false) {
+  for (std::size_t i = 0; i < this->files.size(); ++i) {
+    // The first file wins, as in a linear search
+    this->paths.insert(std::make_pair(normalizePath(this->files[i]), i));
+  }
+}
+
+void chimera::cd_utils::CompileCommandIndex::indexIds_() {
+  ChimeraLogger::verbose("Indexing " + std::to_string(this->files.size()) +
+                         " files by id");
+  for (std::size_t i = 0; i < this->files.size(); ++i) {
+    sys::fs::UniqueID id;
+    if (!sys::fs::getUniqueID(this->files[i], id)) {
+      this->ids.insert(std::make_pair(id, i));
     }
-  } else {
+  }
+  this->idsIndexed = true;
+}
+
+bool chimera::cd_utils::CompileCommandIndex::find(StringRef filepath,
+                                                  std::string &file) {
+  if (this->files.empty()) {
     // This is a FixedCompilationDatabase
     ChimeraLogger::verbose(
         "CompilationDatabase with an empty filelist. Maybe provided by hand");
-    foundFilePath = targetFilePath.str();
+    file = filepath.str();
+    return true;
+  }
+  auto path = this->paths.find(normalizePath(filepath));
+  if (path != this->paths.end()) {
+    file = this->files[path->getValue()];
+    return true;
+  }
+  // A different path of the same file
+  sys::fs::UniqueID id;
+  if (sys::fs::getUniqueID(filepath, id)) {
+    return false;
+  }
+  if (!this->idsIndexed) {
+    this->indexIds_();
+  }
+  auto sameFile = this->ids.find(id);
+  if (sameFile != this->ids.end()) {
+    file = this->files[sameFile->second];
+    return true;
+  }
+  return false;
+}
+
+chimera::cd_utils::CompileCommandVector
+chimera::cd_utils::CompileCommandIndex::getCompileCommands(
+    StringRef filepath) {
+  ChimeraLogger::verboseAndIncr("Retrieving compileCommands for " +
+                                filepath.str());
+  std::string foundFilePath;
+  if (this->find(filepath, foundFilePath)) {
+    ChimeraLogger::verbose("Successful. Match found: " + foundFilePath);
   }
   ChimeraLogger::decrActualVLevel();
   // Return compileCommands
-  return database.getCompileCommands(foundFilePath);
+  return this->database.getCompileCommands(foundFilePath);
+}
+
+chimera::cd_utils::CompileCommandVector
+chimera::cd_utils::getCompileCommandsByFilePath(
+    const CompilationDatabase &database, StringRef filename) {
+  return CompileCommandIndex(database).getCompileCommands(filename);
 }
 
 bool chimera::cd_utils::changeCompileCommandTarget(
@@ -0,0 +1,624 @@
+//===- Coordinator.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file Coordinator.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the coordinator and the workers of a
+///        distributed run
+//===----------------------------------------------------------------------===//
+
+#include "Tooling/Coordinator.h"
+#include "Log.h"
+#include "Utils.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef LLVM_ON_UNIX
+#include <csignal>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+using namespace chimera::distributed;
+using namespace chimera::log;
+
+namespace {
+/// @brief Kinds of the messages
+enum MessageKind : ::std::uint32_t {
+  HelloMessage = 1,
+  UnitMessage,
+  DoneMessage,
+  FileMessage,
+  ResultMessage,
+  HeartbeatMessage
+};
+
+const char helloMagic[] = "chimera-worker";
+const ::std::uint32_t protocolVersion = 2;
+/// @brief Bound on the size of a message, a larger one is a protocol error
+const ::std::uint64_t maxMessageSize = ::std::uint64_t(1) << 28;
+/// @brief Bound on the size of the hello, sent before the peer is known
+const ::std::uint64_t maxHelloSize = 64;
+/// @brief A worker processing a unit sends a heartbeat at this interval
+const ::std::chrono::seconds heartbeatInterval(30);
+/// @brief The coordinator takes a worker silent for this long as lost
+const int workerTimeoutSeconds = 120;
+/// @brief Attempts of a unit, it fails when all its workers are lost
+const unsigned maxUnitAttempts = 3;
+
+void writeU32(::std::string &out, ::std::uint32_t value) {
+  for (unsigned i = 0; i < 4; ++i) {
+    out.push_back(char(value >> (8 * i)));
+  }
+}
+
+void writeString(::std::string &out, ::llvm::StringRef s) {
+  writeU32(out, s.size());
+  out.append(s.data(), s.size());
+}
+
+void writeStrings(::std::string &out, const ::std::vector<::std::string> &v) {
+  writeU32(out, v.size());
+  for (const ::std::string &s : v) {
+    writeString(out, s);
+  }
+}
+
+/// @brief Reader of a message, it fails at the first field out of bounds
+class MessageReader {
+ public:
+  explicit MessageReader(::llvm::StringRef message) : message(message) {}
+
+  bool read(::std::uint32_t &value) {
+    if (this->message.size() < 4) {
+      return false;
+    }
+    value = ::llvm::support::endian::read32le(this->message.data());
+    this->message = this->message.drop_front(4);
+    return true;
+  }
+  bool read(::std::string &s) {
+    ::std::uint32_t size;
+    if (!this->read(size) || this->message.size() < size) {
+      return false;
+    }
+    s = this->message.substr(0, size).str();
+    this->message = this->message.drop_front(size);
+    return true;
+  }
+  bool read(::std::vector<::std::string> &v) {
+    ::std::uint32_t size;
+    if (!this->read(size)) {
+      return false;
+    }
+    v.resize(size);
+    for (::std::string &s : v) {
+      if (!this->read(s)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  ::llvm::StringRef message;  ///< What is left to read
+};
+
+/// @brief Split [host:]port, the host can be bracketed
+void splitAddress(::llvm::StringRef address, ::std::string &host,
+                  ::std::string &port) {
+  ::llvm::StringRef h, p;
+  ::std::tie(h, p) = address.rsplit(':');
+  if (p.empty() && !address.endswith(":")) {
+    // Only the port
+    ::std::swap(h, p);
+  }
+  if (h.startswith("[") && h.endswith("]")) {
+    h = h.drop_front().drop_back();
+  }
+  host = h.str();
+  port = p.str();
+}
+
+#ifdef LLVM_ON_UNIX
+bool sendAll(int fd, ::llvm::StringRef data) {
+  while (!data.empty()) {
+    ssize_t written = ::send(fd, data.data(), data.size(), 0);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data = data.drop_front(written);
+  }
+  return true;
+}
+
+bool receiveAll(int fd, char *data, ::std::size_t size) {
+  while (size > 0) {
+    ssize_t received = ::recv(fd, data, size, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    data += received;
+    size -= received;
+  }
+  return true;
+}
+#endif
+
+/// @brief Send a message, prefixed by its size
+bool sendMessage(int fd, const ::std::string &payload) {
+#ifdef LLVM_ON_UNIX
+  if (payload.size() > maxMessageSize) {
+    return false;
+  }
+  char size[8];
+  ::llvm::support::endian::write64le(size, payload.size());
+  return sendAll(fd, ::llvm::StringRef(size, 8)) && sendAll(fd, payload);
+#else
+  return false;
+#endif
+}
+
+/// @brief Receive a message
+/// @param maxSize The bound on the size, checked before any allocation
+/// @return If a whole message is received
+bool receiveMessage(int fd, ::std::string &payload,
+                    ::std::uint64_t maxSize = maxMessageSize) {
+#ifdef LLVM_ON_UNIX
+  char size[8];
+  if (!receiveAll(fd, size, 8)) {
+    return false;
+  }
+  ::std::uint64_t n = ::llvm::support::endian::read64le(size);
+  if (n > maxSize) {
+    ChimeraLogger::warning("Rejected a message of " + ::std::to_string(n) +
+                           " bytes");
+    return false;
+  }
+  payload.resize(n);
+  return n == 0 || receiveAll(fd, &payload[0], n);
+#else
+  return false;
+#endif
+}
+
+/// @brief Open a socket bound, or connected, to an address
+/// @return The socket, -1 on error
+int openSocket(const ::std::string &address, bool listening) {
+#ifdef LLVM_ON_UNIX
+  ::std::string host, port;
+  splitAddress(address, host, port);
+  ::addrinfo hints;
+  ::std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listening ? AI_PASSIVE : 0;
+  ::addrinfo *addresses;
+  int error = ::getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                            port.c_str(), &hints, &addresses);
+  if (error != 0) {
+    ChimeraLogger::error("Couldn't resolve " + address + ": " +
+                         ::gai_strerror(error));
+    return -1;
+  }
+  int fd = -1;
+  for (::addrinfo *a = addresses; a != nullptr && fd == -1; a = a->ai_next) {
+    fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd == -1) {
+      continue;
+    }
+    int on = 1;
+    bool opened;
+    if (listening) {
+      ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      opened = ::bind(fd, a->ai_addr, a->ai_addrlen) == 0 &&
+               ::listen(fd, SOMAXCONN) == 0;
+    } else {
+      opened = ::connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+    }
+    if (!opened) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  ::freeaddrinfo(addresses);
+  if (fd == -1) {
+    ChimeraLogger::error((listening ? "Couldn't listen on " :
+                                      "Couldn't connect to ") +
+                         address + ": " + ::std::strerror(errno));
+  }
+  // A worker that goes away is reported as a send error
+  ::signal(SIGPIPE, SIG_IGN);
+  return fd;
+#else
+  ChimeraLogger::error("The distributed run isn't supported on this platform");
+  return -1;
+#endif
+}
+
+void closeSocket(int fd) {
+#ifdef LLVM_ON_UNIX
+  ::close(fd);
+#endif
+}
+
+/// @brief If a path sent by a worker stays in the unit output directory
+bool isSafeRelativePath(::llvm::StringRef path) {
+  if (path.empty() || ::llvm::sys::path::is_absolute(path)) {
+    return false;
+  }
+  for (auto c = ::llvm::sys::path::begin(path),
+            e = ::llvm::sys::path::end(path);
+       c != e; ++c) {
+    if (*c == "..") {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Describe a unit, as "<id> (<functions> of <source>)"
+::std::string describeUnit(const WorkUnit &unit) {
+  ::std::string functions;
+  for (const ::std::string &function : unit.functions) {
+    functions += (functions.empty() ? "" : ", ") + function;
+  }
+  return ::std::to_string(unit.id) + " (" +
+         (functions.empty() ? "all the functions" : functions) + " of " +
+         unit.sourcePath + ")";
+}
+
+/// @brief Return the output directory of a unit
+::std::string getUnitDirectory(const ::std::string &outputDirectory,
+                               unsigned id) {
+  return outputDirectory + "unit-" + ::std::to_string(id) +
+         chimera::fs::pathSep;
+}
+} // end anonymous namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// Class Coordinator Implementation
+
+Coordinator::Coordinator(::std::string outputDirectory)
+    : outputDirectory(::std::move(outputDirectory)), listenFD(-1),
+      pending(0), failed(false) {}
+
+Coordinator::~Coordinator() {
+  if (this->listenFD != -1) {
+    closeSocket(this->listenFD);
+  }
+}
+
+void Coordinator::addUnit(WorkUnit unit) {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  unit.id = this->units.size();
+  this->queue.push_back(this->units.size());
+  this->units.push_back(::std::move(unit));
+  this->attempts.push_back(0);
+  this->pending++;
+}
+
+bool Coordinator::listen(const ::std::string &address) {
+  this->listenFD = openSocket(address, true);
+  return this->listenFD != -1;
+}
+
+bool Coordinator::run() {
+#ifdef LLVM_ON_UNIX
+  if (this->listenFD == -1) {
+    return false;
+  }
+  ChimeraLogger::info("Waiting for the workers, " +
+                      ::std::to_string(this->units.size()) + " units");
+  ::std::vector<::std::thread> threads;
+  while (true) {
+    {
+      ::std::lock_guard<::std::mutex> lock(this->mutex);
+      if (this->pending == 0) {
+        // The workers waiting for a unit are told to end, the ones not
+        // introduced yet are disconnected
+        for (int fd : this->connections) {
+          ::shutdown(fd, SHUT_RD);
+        }
+        break;
+      }
+    }
+    ::pollfd p;
+    p.fd = this->listenFD;
+    p.events = POLLIN;
+    if (::poll(&p, 1, 500) <= 0) {
+      continue;
+    }
+    int fd = ::accept(this->listenFD, nullptr, nullptr);
+    if (fd == -1) {
+      continue;
+    }
+    // A worker sends a heartbeat while it processes a unit, a silent one,
+    // as one whose host died, is lost
+    ::timeval timeout;
+    timeout.tv_sec = workerTimeoutSeconds;
+    timeout.tv_usec = 0;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    {
+      ::std::lock_guard<::std::mutex> lock(this->mutex);
+      this->connections.insert(fd);
+    }
+    threads.emplace_back(&Coordinator::serve_, this, fd);
+  }
+  for (::std::thread &t : threads) {
+    t.join();
+  }
+  return !this->failed;
+#else
+  return false;
+#endif
+}
+
+void Coordinator::serve_(int fd) {
+  ::std::string message;
+  MessageReader hello(message);
+  ::std::uint32_t kind, version;
+  ::std::string magic;
+  if (receiveMessage(fd, message, maxHelloSize)) {
+    hello = MessageReader(message);
+  }
+  if (!hello.read(kind) || kind != HelloMessage || !hello.read(magic) ||
+      magic != helloMagic || !hello.read(version) ||
+      version != protocolVersion) {
+    ChimeraLogger::warning("Rejected a connection, not a worker");
+  } else {
+    ::std::size_t index;
+    bool lost = false;
+    while (this->takeUnit_(index)) {
+      const WorkUnit &unit = this->units[index];
+      ::std::string unitDir = getUnitDirectory(this->outputDirectory, unit.id);
+      // Nothing is left of a previous attempt
+      chimera::fs::deleteDirectory(unitDir);
+      message.clear();
+      writeU32(message, UnitMessage);
+      writeU32(message, unit.id);
+      writeString(message, unit.sourcePath);
+      writeStrings(message, unit.functions);
+      writeStrings(message, unit.operators);
+      writeString(message, unit.directory);
+      writeStrings(message, unit.commandLine);
+      bool finished = false, succeeded = false;
+      bool ok = chimera::fs::createDirectories(unitDir) &&
+                sendMessage(fd, message);
+      while (ok && !finished && receiveMessage(fd, message)) {
+        MessageReader r(message);
+        ::std::uint32_t id, status;
+        ::std::string path, content;
+        ok = r.read(kind) && r.read(id) && id == unit.id;
+        if (ok && kind == FileMessage) {
+          ok = r.read(path) && r.read(content) && isSafeRelativePath(path);
+          if (ok) {
+            ::std::string filePath = unitDir + path;
+            ::std::error_code error;
+            chimera::fs::createDirectories(
+                ::llvm::sys::path::parent_path(filePath));
+            ::llvm::raw_fd_ostream file(filePath, error,
+                                        ::llvm::sys::fs::F_None);
+            if (!error) {
+              file << content;
+              file.close();
+            }
+            ok = !error && !file.has_error();
+          }
+        } else if (ok && kind == ResultMessage) {
+          ok = r.read(status);
+          finished = ok;
+          succeeded = status == 0;
+        } else if (ok && kind == HeartbeatMessage) {
+          // The worker is alive
+        } else {
+          ok = false;
+        }
+      }
+      this->completeUnit_(index, finished, succeeded);
+      if (!finished) {
+        lost = true;
+        break;
+      }
+    }
+    if (!lost) {
+      message.clear();
+      writeU32(message, DoneMessage);
+      sendMessage(fd, message);
+    }
+  }
+  {
+    ::std::lock_guard<::std::mutex> lock(this->mutex);
+    this->connections.erase(fd);
+  }
+  closeSocket(fd);
+}
+
+bool Coordinator::takeUnit_(::std::size_t &index) {
+  ::std::unique_lock<::std::mutex> lock(this->mutex);
+  // A unit in progress can come back
+  this->changed.wait(lock, [this]() {
+    return !this->queue.empty() || this->pending == 0;
+  });
+  if (this->queue.empty()) {
+    return false;
+  }
+  index = this->queue.front();
+  this->queue.pop_front();
+  this->attempts[index]++;
+  return true;
+}
+
+void Coordinator::completeUnit_(::std::size_t index, bool finished,
+                                bool succeeded) {
+  const WorkUnit &unit = this->units[index];
+  ::std::string unitDir = getUnitDirectory(this->outputDirectory, unit.id);
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  ::std::string what = "Unit " + describeUnit(unit);
+  if (!finished && this->attempts[index] < maxUnitAttempts) {
+    ChimeraLogger::warning("Lost the worker of the unit " + describeUnit(unit) +
+                           ", queued again");
+    this->queue.push_front(index);
+  } else if (!finished) {
+    // Likely the unit itself makes its workers crash
+    this->pending--;
+    ChimeraLogger::error(what + " failed, lost " +
+                         ::std::to_string(this->attempts[index]) + " workers");
+    this->failed = true;
+  } else {
+    this->pending--;
+    if (succeeded) {
+      this->outputs[::llvm::sys::path::filename(unit.sourcePath).str()]
+          .push_back(unitDir);
+      ChimeraLogger::verbose(what + " done, " +
+                             ::std::to_string(this->pending) + " left");
+    } else {
+      ChimeraLogger::error(what + " failed");
+      this->failed = true;
+    }
+  }
+  this->changed.notify_all();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Worker Implementation
+
+bool chimera::distributed::runWorker(const ::std::string &address,
+                                     const ::std::string &scratchDirectory,
+                                     const UnitProcessor &process) {
+  int fd = openSocket(address, false);
+  if (fd == -1) {
+    return false;
+  }
+  ::std::string message;
+  writeU32(message, HelloMessage);
+  writeString(message, helloMagic);
+  writeU32(message, protocolVersion);
+  bool ok = sendMessage(fd, message);
+  while (ok) {
+    ::std::uint32_t kind = 0;
+    WorkUnit unit;
+    if (!receiveMessage(fd, message)) {
+      ChimeraLogger::error("Lost the coordinator");
+      ok = false;
+      break;
+    }
+    MessageReader r(message);
+    if (r.read(kind) && kind == DoneMessage) {
+      break;
+    }
+    if (kind != UnitMessage || !r.read(unit.id) || !r.read(unit.sourcePath) ||
+        !r.read(unit.functions) || !r.read(unit.operators) ||
+        !r.read(unit.directory) || !r.read(unit.commandLine)) {
+      ChimeraLogger::error("Unexpected message from the coordinator");
+      ok = false;
+      break;
+    }
+    ChimeraLogger::info("Unit " + describeUnit(unit));
+    ::std::string unitDir = getUnitDirectory(scratchDirectory, unit.id);
+    ::std::string outputDir = unitDir + "mutants";
+    // The heartbeats tell the coordinator that the unit is in progress
+    ::std::mutex heartbeatMutex;
+    ::std::condition_variable processed;
+    bool processing = true;
+    ::std::thread heartbeat([&]() {
+      ::std::string beat;
+      writeU32(beat, HeartbeatMessage);
+      writeU32(beat, unit.id);
+      ::std::unique_lock<::std::mutex> lock(heartbeatMutex);
+      while (!processed.wait_for(lock, heartbeatInterval,
+                                 [&]() { return !processing; }) &&
+             sendMessage(fd, beat)) {
+      }
+    });
+    bool succeeded = chimera::fs::createDirectories(outputDir) &&
+                     process(unit, outputDir);
+    {
+      ::std::lock_guard<::std::mutex> lock(heartbeatMutex);
+      processing = false;
+    }
+    processed.notify_all();
+    heartbeat.join();
+
+    // Send the target output directory back
+    ::std::string targetDir =
+        outputDir + chimera::fs::pathSep +
+        ::llvm::sys::path::filename(unit.sourcePath).str() +
+        chimera::fs::pathSep;
+    ::std::error_code error;
+    for (::llvm::sys::fs::recursive_directory_iterator f(targetDir, error), end;
+         ok && !error && f != end; f.increment(error)) {
+      if (!::llvm::sys::fs::is_regular_file(f->path())) {
+        continue;
+      }
+      auto buffer = ::llvm::MemoryBuffer::getFile(f->path());
+      if (!buffer) {
+        ChimeraLogger::error("Couldn't read " + f->path());
+        succeeded = false;
+        continue;
+      }
+      message.clear();
+      writeU32(message, FileMessage);
+      writeU32(message, unit.id);
+      writeString(message,
+                  ::llvm::StringRef(f->path()).drop_front(targetDir.size()));
+      writeString(message, (*buffer)->getBuffer());
+      if (message.size() > maxMessageSize) {
+        ChimeraLogger::error(f->path() + " is too large to be sent");
+        succeeded = false;
+        continue;
+      }
+      ok = sendMessage(fd, message);
+    }
+    chimera::fs::deleteDirectory(unitDir);
+    message.clear();
+    writeU32(message, ResultMessage);
+    writeU32(message, unit.id);
+    writeU32(message, succeeded ? 0 : 1);
+    ok = ok && sendMessage(fd, message);
+    if (!ok) {
+      ChimeraLogger::error("Lost the coordinator");
+    }
+  }
+  closeSocket(fd);
+  return ok;
+}
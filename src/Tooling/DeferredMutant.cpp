@@ -0,0 +1,151 @@
+//===- DeferredMutant.cpp ---------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file DeferredMutant.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the class DeferredMutant
+//===----------------------------------------------------------------------===//
+
+#include "Tooling/DeferredMutant.h"
+#include "Tooling/LexicalPrefilter.h"
+
+#include <algorithm>
+
+namespace {
+/// @brief Text of the dropped steps: [tBegin, tEnd) of the code with all the
+/// steps is [cBegin, cEnd) of the composed code
+struct Hole {
+  long tBegin, tEnd;
+  long cBegin, cEnd;
+};
+
+/// @brief Map a position outside the holes to the composed code
+long map(const ::std::vector<Hole> &holes, long p) {
+  long offset = 0;
+  for (const Hole &h : holes) {
+    if (h.tEnd > p) {
+      break;
+    }
+    offset = h.cEnd - h.tEnd;
+  }
+  return p + offset;
+}
+} // end anonymous namespace
+
+chimera::DeferredMutant::DeferredMutant(::std::string original)
+    : original(::std::move(original)) {
+  this->last = this->original;
+}
+
+void chimera::DeferredMutant::addStep(const ::std::string &code) {
+  ::std::size_t prefix, suffix;
+  prefilter::findEditedRegion(this->last, code, prefix, suffix);
+  this->steps.push_back(
+      Step{prefix, this->last.size() - suffix,
+           code.substr(prefix, code.size() - prefix - suffix)});
+  this->last = code;
+}
+
+::std::string
+chimera::DeferredMutant::compose_(::std::vector<bool> &keep) const {
+  ::std::string code = this->original;
+  ::std::vector<Hole> holes; // Sorted and disjoint
+  for (::std::size_t i = 0; i < this->steps.size(); ++i) {
+    const Step &s = this->steps[i];
+    long begin = s.begin, end = s.end;
+    long delta = long(s.text.size()) - (end - begin);
+    // The holes overlapping or touching the step: an edit next to a dropped
+    // text may extend it
+    auto first = ::std::find_if(
+        holes.begin(), holes.end(),
+        [begin](const Hole &h) { return h.tEnd >= begin; });
+    auto after = ::std::find_if(
+        first, holes.end(), [end](const Hole &h) { return h.tBegin > end; });
+    if (keep[i] && first == after) {
+      long cBegin = map(holes, begin);
+      code.replace(cBegin, end - begin, s.text);
+      for (auto h = after; h != holes.end(); ++h) {
+        h->tBegin += delta;
+        h->tEnd += delta;
+        h->cBegin += delta;
+        h->cEnd += delta;
+      }
+      continue;
+    }
+    // Dropped: its text becomes a hole, merged with the ones it touches
+    keep[i] = false;
+    Hole hole;
+    if (first != after && first->tBegin <= begin) {
+      hole.tBegin = first->tBegin;
+      hole.cBegin = first->cBegin;
+    } else {
+      hole.tBegin = begin;
+      hole.cBegin = map(holes, begin);
+    }
+    if (first != after && (after - 1)->tEnd >= end) {
+      hole.tEnd = (after - 1)->tEnd + delta;
+      hole.cEnd = (after - 1)->cEnd;
+    } else {
+      hole.tEnd = end + delta;
+      hole.cEnd = map(holes, end);
+    }
+    for (auto h = after; h != holes.end(); ++h) {
+      h->tBegin += delta;
+      h->tEnd += delta;
+    }
+    holes.insert(holes.erase(first, after), hole);
+  }
+  return code;
+}
+
+void chimera::DeferredMutant::bisect_(const Checker &check,
+                                      ::std::vector<bool> &keep,
+                                      ::std::size_t first, ::std::size_t last,
+                                      ::std::string &code,
+                                      unsigned &checks) const {
+  ::std::vector<bool> tentative = keep;
+  ::std::fill(tentative.begin() + first, tentative.begin() + last, true);
+  ::std::string tentativeCode = this->compose_(tentative);
+  ++checks;
+  if (check(tentativeCode)) {
+    keep = ::std::move(tentative);
+    code = ::std::move(tentativeCode);
+    return;
+  }
+  if (last - first == 1) {
+    // Found a broken step, keep[first] is already false
+    return;
+  }
+  ::std::size_t middle = first + (last - first) / 2;
+  this->bisect_(check, keep, first, middle, code, checks);
+  this->bisect_(check, keep, middle, last, code, checks);
+}
+
+::std::vector<bool>
+chimera::DeferredMutant::validate(const Checker &check, ::std::string &code,
+                                  unsigned &checks) const {
+  ::std::vector<bool> keep(this->steps.size(), false);
+  code = this->original;
+  checks = 0;
+  if (!this->steps.empty()) {
+    this->bisect_(check, keep, 0, this->steps.size(), code, checks);
+  }
+  return keep;
+}
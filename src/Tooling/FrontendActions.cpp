@@ -87,6 +87,17 @@ int chimera::checkSyntaxAction(const ::clang::tooling::CompileCommand& c,
       newFrontendActionFactory<clang::SyntaxOnlyAction>().get());
 }
 
+int chimera::checkSyntaxActionOnCode(const ::clang::tooling::CompileCommand& c,
+                                     const ::std::string& sourceFilePath,
+                                     ::llvm::StringRef code) {
+  // The ClangTool keeps a reference to the database, it must outlive the run
+  ::chimera::cd_utils::FlexibleCompilationDatabase database(c);
+  ClangTool tool(database, sourceFilePath);
+  // Overlay the source file with the in-memory code
+  tool.mapVirtualFile(sourceFilePath, code);
+  return tool.run(newFrontendActionFactory<clang::SyntaxOnlyAction>().get());
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void chimera::PreprocessIncludeAction::EndSourceFileAction() {
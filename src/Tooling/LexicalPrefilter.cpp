@@ -0,0 +1,206 @@
+//===- LexicalPrefilter.cpp -------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file LexicalPrefilter.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the lexical filter
+//===----------------------------------------------------------------------===//
+
+#include "Tooling/LexicalPrefilter.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace chimera::prefilter;
+
+namespace {
+/// @brief The counted characters, the index in the counters array
+const char countedChars[] = {'(', ')', '[', ']', '{', '}', '"', '\'', '\\', '/'};
+enum CountedIndex {
+  OpenParen,
+  CloseParen,
+  OpenBracket,
+  CloseBracket,
+  OpenBrace,
+  CloseBrace,
+  DoubleQuote,
+  SingleQuote,
+  Backslash,
+  Slash,
+  NumCounted
+};
+
+/// @brief Occurrences of the counted characters in a region
+struct Counts {
+  long c[NumCounted];
+  Counts() { ::std::fill(c, c + NumCounted, 0); }
+
+  long delta(CountedIndex open, CountedIndex close) const {
+    return this->c[open] - this->c[close];
+  }
+};
+
+/// @brief Length of the common prefix of a and b, long n at most
+::std::size_t commonPrefix(const char *a, const char *b, ::std::size_t n) {
+  ::std::size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    unsigned diff = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
+    if (diff != 0) {
+      return i + __builtin_ctz(diff);
+    }
+  }
+#endif
+  while (i < n && a[i] == b[i]) {
+    ++i;
+  }
+  return i;
+}
+
+/// @brief Length of the common suffix of the buffers ending at a and b, long n
+/// at most
+::std::size_t commonSuffix(const char *aEnd, const char *bEnd,
+                           ::std::size_t n) {
+  ::std::size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    __m128i x =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(aEnd - i - 16));
+    __m128i y =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(bEnd - i - 16));
+    unsigned diff = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
+    if (diff != 0) {
+      // The last differing byte is the highest set bit
+      return i + 15 - (31 - __builtin_clz(diff));
+    }
+  }
+#endif
+  while (i < n && *(aEnd - i - 1) == *(bEnd - i - 1)) {
+    ++i;
+  }
+  return i;
+}
+
+/// @brief Count the occurrences of the counted characters
+Counts count(::llvm::StringRef region) {
+  Counts counts;
+  const char *p = region.data();
+  ::std::size_t n = region.size();
+  ::std::size_t i = 0;
+#if defined(__SSE2__)
+  __m128i needles[NumCounted];
+  for (unsigned k = 0; k < NumCounted; ++k) {
+    needles[k] = _mm_set1_epi8(countedChars[k]);
+  }
+  for (; i + 16 <= n; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    for (unsigned k = 0; k < NumCounted; ++k) {
+      counts.c[k] += __builtin_popcount(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needles[k])));
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    for (unsigned k = 0; k < NumCounted; ++k) {
+      if (p[i] == countedChars[k]) {
+        counts.c[k]++;
+      }
+    }
+  }
+  return counts;
+}
+
+/// @brief If the region could contain a comment
+bool hasComment(::llvm::StringRef region, const Counts &counts) {
+  return counts.c[Slash] != 0 && (region.find("//") != ::llvm::StringRef::npos ||
+                                  region.find("/*") != ::llvm::StringRef::npos);
+}
+} // end anonymous namespace
+
+void chimera::prefilter::findEditedRegion(::llvm::StringRef original,
+                                          ::llvm::StringRef mutant,
+                                          ::std::size_t &prefix,
+                                          ::std::size_t &suffix) {
+  ::std::size_t shorter = ::std::min(original.size(), mutant.size());
+  prefix = commonPrefix(original.data(), mutant.data(), shorter);
+  suffix = commonSuffix(original.data() + original.size(),
+                        mutant.data() + mutant.size(), shorter - prefix);
+}
+
+const char *chimera::prefilter::getVerdictName(Verdict v) {
+  switch (v) {
+  case Plausible:
+    return "plausible";
+  case UnbalancedParens:
+    return "unbalanced parentheses";
+  case UnbalancedBrackets:
+    return "unbalanced brackets";
+  case UnbalancedBraces:
+    return "unbalanced braces";
+  case UnbalancedQuotes:
+    return "unbalanced quotes";
+  default:
+    return "unknown";
+  }
+}
+
+Verdict chimera::prefilter::check(::llvm::StringRef original,
+                                  ::llvm::StringRef mutant) {
+  // Strip the common prefix and suffix, they can't unbalance anything
+  ::std::size_t prefix, suffix;
+  findEditedRegion(original, mutant, prefix, suffix);
+  ::llvm::StringRef originalRegion =
+      original.substr(prefix, original.size() - prefix - suffix);
+  ::llvm::StringRef mutantRegion =
+      mutant.substr(prefix, mutant.size() - prefix - suffix);
+
+  Counts o = count(originalRegion);
+  Counts m = count(mutantRegion);
+
+  bool quotes = o.c[DoubleQuote] + m.c[DoubleQuote] != 0 ||
+                o.c[SingleQuote] + m.c[SingleQuote] != 0;
+  bool escapes = o.c[Backslash] + m.c[Backslash] != 0;
+  // Brackets can be part of string/char literals or comments
+  if (!quotes && !escapes && !hasComment(originalRegion, o) &&
+      !hasComment(mutantRegion, m)) {
+    if (o.delta(OpenParen, CloseParen) != m.delta(OpenParen, CloseParen)) {
+      return UnbalancedParens;
+    }
+    if (o.delta(OpenBracket, CloseBracket) !=
+        m.delta(OpenBracket, CloseBracket)) {
+      return UnbalancedBrackets;
+    }
+    if (o.delta(OpenBrace, CloseBrace) != m.delta(OpenBrace, CloseBrace)) {
+      return UnbalancedBraces;
+    }
+  }
+  // Double quotes can be escaped or char literals
+  if (!escapes && o.c[SingleQuote] + m.c[SingleQuote] == 0 &&
+      (o.c[DoubleQuote] - m.c[DoubleQuote]) % 2 != 0) {
+    return UnbalancedQuotes;
+  }
+  return Plausible;
+}
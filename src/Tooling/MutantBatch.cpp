@@ -0,0 +1,148 @@
+//===- MutantBatch.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file MutantBatch.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the class MutantBatch
+//===----------------------------------------------------------------------===//
+
+#include "Tooling/LexicalPrefilter.h"
+#include "Tooling/MutantBatch.h"
+
+#include <algorithm>
+#include <map>
+
+chimera::MutantBatch::MutantBatch(
+    ::std::shared_ptr<const ::std::string> original, unsigned maxClones)
+    : original(original), maxClones(::std::max(1u, maxClones)), clones(0) {}
+
+void chimera::MutantBatch::add(ValidationPool::CodePtr code,
+                               const CloneSite *site,
+                               const ::std::vector<::std::string> &extraArgs) {
+  Item item{SingleItem, code, extraArgs, CloneSite(), false};
+  if (site != nullptr) {
+    // All the edits must be in the body, the rest of the clone is renamed
+    ::std::size_t prefix, suffix;
+    prefilter::findEditedRegion(*this->original, *code, prefix, suffix);
+    if (prefix >= site->bodyBegin &&
+        this->original->size() - suffix <= site->declEnd) {
+      item.kind = CloneItem;
+      item.site = *site;
+      this->clones++;
+    }
+  }
+  this->items.push_back(::std::move(item));
+}
+
+void chimera::MutantBatch::addResolved(bool valid) {
+  this->items.push_back(Item{ResolvedItem, nullptr,
+                             ::std::vector<::std::string>(), CloneSite(),
+                             valid});
+}
+
+::std::string chimera::MutantBatch::getCloneCode_(::std::size_t index) const {
+  const Item &item = this->items[index];
+  const CloneSite &site = item.site;
+  // The edits are in the body, the function grows of the size difference
+  ::std::size_t length = site.declEnd - site.declBegin + item.code->size() -
+                         this->original->size();
+  ::std::string clone = item.code->substr(site.declBegin, length);
+  clone.insert(site.nameEnd - site.declBegin,
+               "__chimera_mut_" + ::std::to_string(index));
+  return clone;
+}
+
+void chimera::MutantBatch::checkClones_(ValidationSession &session,
+                                        ::std::vector<::std::size_t> indexes,
+                                        ::std::vector<bool> &results) const {
+  const ::std::vector<::std::string> &extraArgs =
+      this->items[indexes.front()].extraArgs;
+  if (indexes.size() == 1) {
+    results[indexes.front()] =
+        session.check(*this->items[indexes.front()].code, extraArgs);
+    return;
+  }
+  // Each clone follows its function, in the original order
+  ::std::stable_sort(indexes.begin(), indexes.end(),
+                     [this](::std::size_t a, ::std::size_t b) {
+                       return this->items[a].site.declEnd <
+                              this->items[b].site.declEnd;
+                     });
+  ::std::string code;
+  code.reserve(this->original->size() * 2);
+  ::std::vector<ValidationSession::Range> ranges;
+  ::std::size_t copied = 0;
+  for (::std::size_t i : indexes) {
+    unsigned declEnd = this->items[i].site.declEnd;
+    code.append(*this->original, copied, declEnd - copied);
+    copied = declEnd;
+    code.push_back('\n');
+    unsigned begin = code.size();
+    code += this->getCloneCode_(i);
+    ranges.push_back(ValidationSession::Range(begin, code.size()));
+  }
+  code.append(*this->original, copied, ::std::string::npos);
+
+  ::std::vector<bool> implicated;
+  bool attributed =
+      session.checkAttributing(code, ranges, implicated, extraArgs);
+  for (::std::size_t k = 0; k < indexes.size(); ++k) {
+    const Item &item = this->items[indexes[k]];
+    if (!attributed || implicated[k]) {
+      // Check it alone
+      results[indexes[k]] = session.check(*item.code, extraArgs);
+    } else {
+      results[indexes[k]] = true;
+      session.storeCache(*item.code, extraArgs, true);
+    }
+  }
+}
+
+::std::vector<bool>
+chimera::MutantBatch::check(ValidationSession &session) const {
+  ::std::vector<bool> results(this->items.size(), false);
+  // A parse per set of additional arguments
+  ::std::map<::std::vector<::std::string>, ::std::vector<::std::size_t>>
+      cloneGroups;
+  for (::std::size_t i = 0; i < this->items.size(); ++i) {
+    const Item &item = this->items[i];
+    bool valid;
+    switch (item.kind) {
+    case ResolvedItem:
+      results[i] = item.valid;
+      break;
+    case SingleItem:
+      results[i] = session.check(*item.code, item.extraArgs);
+      break;
+    case CloneItem:
+      // The cached ones don't need the parse
+      if (session.lookupCache(*item.code, item.extraArgs, valid)) {
+        results[i] = valid;
+      } else {
+        cloneGroups[item.extraArgs].push_back(i);
+      }
+      break;
+    }
+  }
+  for (const auto &group : cloneGroups) {
+    this->checkClones_(session, group.second, results);
+  }
+  return results;
+}
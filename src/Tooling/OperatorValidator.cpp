@@ -0,0 +1,314 @@
+//===- OperatorValidator.cpp ------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file OperatorValidator.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the validator of binary operator replacements
+//===----------------------------------------------------------------------===//
+
+#include "Tooling/OperatorValidator.h"
+
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/Basic/OperatorPrecedence.h"
+#include "llvm/ADT/StringRef.h"
+
+using namespace clang;
+using namespace chimera::opvalidator;
+
+namespace {
+/// @brief Operators grouped by the operands they accept and the result
+enum OperatorClass {
+  ArithmeticClass,       ///< * / + -, usual arithmetic conversions
+  IntegerClass,          ///< % & ^ |, as above on integers
+  ShiftClass,            ///< << >>, the promoted left operand
+  ComparisonClass,       ///< < > <= >= == !=, bool (int in C)
+  LogicalClass,          ///< && ||, bool (int in C)
+  ArithmeticAssignClass, ///< *= /= += -=, the left operand lvalue
+  IntegerAssignClass,    ///< %= &= ^= |= <<= >>=, as above on integers
+  OtherClass             ///< Not handled
+};
+
+OperatorClass classify(BinaryOperatorKind k) {
+  switch (k) {
+  case BO_Mul:
+  case BO_Div:
+  case BO_Add:
+  case BO_Sub:
+    return ArithmeticClass;
+  case BO_Rem:
+  case BO_And:
+  case BO_Xor:
+  case BO_Or:
+    return IntegerClass;
+  case BO_Shl:
+  case BO_Shr:
+    return ShiftClass;
+  case BO_LT:
+  case BO_GT:
+  case BO_LE:
+  case BO_GE:
+  case BO_EQ:
+  case BO_NE:
+    return ComparisonClass;
+  case BO_LAnd:
+  case BO_LOr:
+    return LogicalClass;
+  case BO_MulAssign:
+  case BO_DivAssign:
+  case BO_AddAssign:
+  case BO_SubAssign:
+    return ArithmeticAssignClass;
+  case BO_RemAssign:
+  case BO_AndAssign:
+  case BO_XorAssign:
+  case BO_OrAssign:
+  case BO_ShlAssign:
+  case BO_ShrAssign:
+    return IntegerAssignClass;
+  default:
+    return OtherClass;
+  }
+}
+
+/// @brief The group of classes with the same result on the same operands
+int getResultGroup(OperatorClass c) {
+  switch (c) {
+  case ArithmeticClass:
+  case IntegerClass:
+    return 0;
+  case ShiftClass:
+    return 1;
+  case ComparisonClass:
+  case LogicalClass:
+    return 2;
+  case ArithmeticAssignClass:
+  case IntegerAssignClass:
+    return 3;
+  default:
+    return -1;
+  }
+}
+
+bool needsIntegers(OperatorClass c) {
+  return c == IntegerClass || c == ShiftClass || c == IntegerAssignClass;
+}
+
+prec::Level getPrecedence(BinaryOperatorKind k) {
+  switch (k) {
+  case BO_PtrMemD:
+  case BO_PtrMemI:
+    return prec::PointerToMember;
+  case BO_Mul:
+  case BO_Div:
+  case BO_Rem:
+    return prec::Multiplicative;
+  case BO_Add:
+  case BO_Sub:
+    return prec::Additive;
+  case BO_Shl:
+  case BO_Shr:
+    return prec::Shift;
+  case BO_LT:
+  case BO_GT:
+  case BO_LE:
+  case BO_GE:
+    return prec::Relational;
+  case BO_EQ:
+  case BO_NE:
+    return prec::Equality;
+  case BO_And:
+    return prec::And;
+  case BO_Xor:
+    return prec::ExclusiveOr;
+  case BO_Or:
+    return prec::InclusiveOr;
+  case BO_LAnd:
+    return prec::LogicalAnd;
+  case BO_LOr:
+    return prec::LogicalOr;
+  case BO_Comma:
+    return prec::Comma;
+  default:
+    return prec::Assignment;
+  }
+}
+
+/// @brief If the builtin operators on the type don't depend on overloads
+bool isReal(QualType t, bool cplusplus) {
+  // The C++ enumerations can have overloaded operators
+  return t->isRealType() && !(cplusplus && t->isEnumeralType());
+}
+
+/// @brief If an operand, written without parentheses, stays an operand of
+/// the replacement
+bool staysOperand(const Expr *operand, bool isLHS, prec::Level level) {
+  operand = operand->IgnoreImpCasts();
+  if (const BinaryOperator *b = dyn_cast<BinaryOperator>(operand)) {
+    prec::Level l = getPrecedence(b->getOpcode());
+    // Left associative, but the assignments
+    return l > level || (l == level && isLHS == (level != prec::Assignment));
+  }
+  if (const CXXOperatorCallExpr *c = dyn_cast<CXXOperatorCallExpr>(operand)) {
+    // Only the bracketed ones are sure
+    return c->getOperator() == OO_Subscript || c->getOperator() == OO_Call;
+  }
+  return !isa<AbstractConditionalOperator>(operand) &&
+         !isa<CXXThrowExpr>(operand);
+}
+
+/// @brief If the replaced operation, written without parentheses, stays an
+/// operand of its parent
+bool staysInParent(const BinaryOperator *op, prec::Level level,
+                   ASTContext &context) {
+  ast_type_traits::DynTypedNode node =
+      ast_type_traits::DynTypedNode::create(*op);
+  while (true) {
+    ASTContext::DynTypedNodeList parents = context.getParents(node);
+    if (parents.empty()) {
+      return true;
+    }
+    const Expr *child = node.get<Expr>();
+    node = parents[0];
+    const Expr *parent = node.get<Expr>();
+    if (parent == nullptr || isa<ParenExpr>(parent)) {
+      // A statement or a declaration
+      return true;
+    }
+    if (isa<ImplicitCastExpr>(parent) || isa<ExprWithCleanups>(parent)) {
+      continue;
+    }
+    if (const BinaryOperator *b = dyn_cast<BinaryOperator>(parent)) {
+      prec::Level l = getPrecedence(b->getOpcode());
+      bool isLHS = b->getLHS()->IgnoreImpCasts() == child;
+      return level > l || (level == l && isLHS == (l != prec::Assignment));
+    }
+    if (isa<AbstractConditionalOperator>(parent)) {
+      return level > prec::Conditional;
+    }
+    if (const CXXOperatorCallExpr *c = dyn_cast<CXXOperatorCallExpr>(parent)) {
+      return c->getOperator() == OO_Subscript || c->getOperator() == OO_Call;
+    }
+    // Calls, initializers, subscripts, ... delimit the operation. A unary
+    // operator needs the parentheses, without them it's unexpected.
+    return !isa<UnaryOperator>(parent);
+  }
+}
+
+/// @brief If the code of the operation belongs to a template or to one of
+/// its instantiations, which share the text
+bool isInTemplate(const BinaryOperator *op, ASTContext &context) {
+  ast_type_traits::DynTypedNode node =
+      ast_type_traits::DynTypedNode::create(*op);
+  const Decl *decl = nullptr;
+  while (decl == nullptr) {
+    ASTContext::DynTypedNodeList parents = context.getParents(node);
+    if (parents.empty()) {
+      // Nowhere to look
+      return true;
+    }
+    node = parents[0];
+    decl = node.get<Decl>();
+  }
+  const DeclContext *dc = dyn_cast<DeclContext>(decl);
+  for (dc = dc != nullptr ? dc : decl->getDeclContext(); dc != nullptr;
+       dc = dc->getParent()) {
+    if (dc->isDependentContext()) {
+      return true;
+    }
+    if (const FunctionDecl *f = dyn_cast<FunctionDecl>(dc)) {
+      if (f->getTemplateInstantiationPattern() != nullptr) {
+        return true;
+      }
+    } else if (const CXXRecordDecl *r = dyn_cast<CXXRecordDecl>(dc)) {
+      if (r->getTemplateInstantiationPattern() != nullptr) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+} // end anonymous namespace
+
+const char *chimera::opvalidator::getVerdictName(Verdict v) {
+  switch (v) {
+  case Unknown:
+    return "unknown";
+  case Valid:
+    return "valid";
+  case Invalid:
+    return "invalid";
+  default:
+    return "unknown";
+  }
+}
+
+bool chimera::opvalidator::acceptsCommandLine(
+    const ::std::vector<::std::string> &commandLine) {
+  for (const ::std::string &arg : commandLine) {
+    ::llvm::StringRef a(arg);
+    if (a.startswith("-Werror") || a == "-pedantic-errors") {
+      return false;
+    }
+  }
+  return true;
+}
+
+Verdict chimera::opvalidator::check(const BinaryOperator *op,
+                                    BinaryOperatorKind replacement,
+                                    ASTContext &context) {
+  if (op == nullptr) {
+    return Unknown;
+  }
+  OperatorClass original = classify(op->getOpcode());
+  OperatorClass replacing = classify(replacement);
+  // A different result could be rejected by the context
+  if (original == OtherClass || replacing == OtherClass ||
+      getResultGroup(original) != getResultGroup(replacing)) {
+    return Unknown;
+  }
+  // Macros, templates and constant expressions need the frontend
+  if (op->isTypeDependent() || op->isValueDependent() ||
+      op->getOperatorLoc().isMacroID() || op->getLocStart().isMacroID() ||
+      op->getLocEnd().isMacroID() || op->isEvaluatable(context) ||
+      isInTemplate(op, context)) {
+    return Unknown;
+  }
+
+  bool cplusplus = context.getLangOpts().CPlusPlus;
+  QualType lhs = op->getLHS()->IgnoreImpCasts()->getType();
+  QualType rhs = op->getRHS()->IgnoreImpCasts()->getType();
+  if (!isReal(lhs, cplusplus) || !isReal(rhs, cplusplus)) {
+    // Pointers, classes, vectors, ...
+    return Unknown;
+  }
+  // The replacement must not change how the text is parsed
+  prec::Level level = getPrecedence(replacement);
+  if (!staysOperand(op->getLHS(), true, level) ||
+      !staysOperand(op->getRHS(), false, level) ||
+      !staysInParent(op, level, context)) {
+    return Unknown;
+  }
+  if (needsIntegers(replacing) &&
+      !(lhs->isIntegerType() && rhs->isIntegerType())) {
+    return Invalid;
+  }
+  return Valid;
+}
@@ -0,0 +1,80 @@
+//===- OutputQueue.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file OutputQueue.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the class OutputQueue
+//===----------------------------------------------------------------------===//
+
+#include "Tooling/OutputQueue.h"
+
+#include <algorithm>
+
+chimera::OutputQueue::OutputQueue(::std::size_t maxPending)
+    : maxPending(::std::max<::std::size_t>(1, maxPending)), busy(false),
+      stopping(false) {
+  this->thread = ::std::thread(&OutputQueue::work_, this);
+}
+
+chimera::OutputQueue::~OutputQueue() {
+  this->drain();
+  {
+    ::std::lock_guard<::std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->taskAvailable.notify_one();
+  this->thread.join();
+}
+
+void chimera::OutputQueue::push(Task task) {
+  {
+    ::std::unique_lock<::std::mutex> lock(this->mutex);
+    this->taskDone.wait(
+        lock, [this]() { return this->tasks.size() < this->maxPending; });
+    this->tasks.push_back(::std::move(task));
+  }
+  this->taskAvailable.notify_one();
+}
+
+void chimera::OutputQueue::drain() {
+  ::std::unique_lock<::std::mutex> lock(this->mutex);
+  this->taskDone.wait(
+      lock, [this]() { return this->tasks.empty() && !this->busy; });
+}
+
+void chimera::OutputQueue::work_() {
+  ::std::unique_lock<::std::mutex> lock(this->mutex);
+  while (true) {
+    this->taskAvailable.wait(
+        lock, [this]() { return this->stopping || !this->tasks.empty(); });
+    if (this->tasks.empty()) {
+      // Stopping, and nothing left
+      return;
+    }
+    Task task = ::std::move(this->tasks.front());
+    this->tasks.pop_front();
+    this->busy = true;
+    lock.unlock();
+    task();
+    lock.lock();
+    this->busy = false;
+    this->taskDone.notify_all();
+  }
+}
@@ -0,0 +1,179 @@
+//===- ValidationCache.cpp --------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ValidationCache.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the class ValidationCache
+//===----------------------------------------------------------------------===//
+
+#include "Log.h"
+#include "Utils.h"
+#include "Tooling/ValidationCache.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace chimera::log;
+
+/// @brief First line of the cache file, to be changed with the format
+static const char *cacheHeader = "chimera-validation-cache 1";
+static const char *cacheFilename = "validation-cache";
+
+chimera::ValidationCache::ValidationCache(const ::std::string &directory,
+                                          ::std::size_t maxEntries)
+    : filePath(directory + ::chimera::fs::pathSep + cacheFilename),
+      maxEntries(maxEntries), dirty(false), hits(0), misses(0) {
+  this->load_();
+}
+
+chimera::ValidationCache::~ValidationCache() { this->flush(); }
+
+chimera::ValidationCache::KeyType chimera::ValidationCache::computeKey(
+    ::llvm::StringRef code, const ::clang::tooling::CompileCommand &command,
+    const ::std::vector<::std::string> &extraArgs) {
+  // Each field is terminated, so different splits don't collide
+  const ::llvm::StringRef terminator("\0", 1);
+  ::llvm::MD5 hash;
+  hash.update(code);
+  hash.update(terminator);
+  hash.update(command.Directory);
+  hash.update(terminator);
+  for (const auto &arg : command.CommandLine) {
+    hash.update(arg);
+    hash.update(terminator);
+  }
+  hash.update(terminator);
+  for (const auto &arg : extraArgs) {
+    hash.update(arg);
+    hash.update(terminator);
+  }
+  ::llvm::MD5::MD5Result result;
+  hash.final(result);
+  ::llvm::SmallString<32> digest;
+  ::llvm::MD5::stringifyResult(result, digest);
+  return KeyType(digest.begin(), digest.end());
+}
+
+bool chimera::ValidationCache::lookup(const KeyType &key, bool &valid) {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  auto it = this->index.find(key);
+  if (it == this->index.end()) {
+    this->misses++;
+    return false;
+  }
+  // Move to the front, as most recently used
+  this->entries.splice(this->entries.begin(), this->entries, it->second);
+  valid = it->second->second;
+  this->hits++;
+  this->dirty = true;
+  return true;
+}
+
+void chimera::ValidationCache::insert(const KeyType &key, bool valid) {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  this->insert_(key, valid);
+}
+
+void chimera::ValidationCache::insert_(const KeyType &key, bool valid) {
+  auto it = this->index.find(key);
+  if (it != this->index.end()) {
+    it->second->second = valid;
+    this->entries.splice(this->entries.begin(), this->entries, it->second);
+  } else {
+    this->entries.emplace_front(key, valid);
+    this->index[key] = this->entries.begin();
+    // Evict the least recently used
+    while (this->entries.size() > this->maxEntries) {
+      this->index.erase(this->entries.back().first);
+      this->entries.pop_back();
+    }
+  }
+  this->dirty = true;
+}
+
+void chimera::ValidationCache::load_() {
+  auto buffer = ::llvm::MemoryBuffer::getFile(this->filePath);
+  if (!buffer) {
+    // No cache yet
+    return;
+  }
+  ::llvm::SmallVector<::llvm::StringRef, 0> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  if (lines.empty() || lines[0] != cacheHeader) {
+    ChimeraLogger::warning("Ignoring the validation cache " + this->filePath +
+                           ": unknown format");
+    return;
+  }
+  // The file lists the verdicts from the least recently used
+  for (unsigned i = 1; i < lines.size(); ++i) {
+    ::std::pair<::llvm::StringRef, ::llvm::StringRef> fields =
+        lines[i].split(' ');
+    if (fields.first.size() != 32 ||
+        (fields.second != "0" && fields.second != "1")) {
+      continue;
+    }
+    this->insert_(fields.first.str(), fields.second == "1");
+  }
+  this->dirty = false;
+  ChimeraLogger::verbose("Loaded " + ::std::to_string(this->entries.size()) +
+                         " verdicts from the validation cache");
+}
+
+bool chimera::ValidationCache::flush() {
+  ::std::lock_guard<::std::mutex> lock(this->mutex);
+  if (!this->dirty) {
+    return true;
+  }
+  // Write aside and rename, a crash doesn't leave a truncated cache. The
+  // temporary file is unique, the processes sharing the cache don't write
+  // in the same one.
+  ::llvm::SmallString<256> tempPath;
+  int fd;
+  ::std::error_code fileError = ::llvm::sys::fs::createUniqueFile(
+      this->filePath + "-%%%%%%%%.tmp", fd, tempPath);
+  if (fileError) {
+    ChimeraLogger::error("Couldn't write the validation cache: " +
+                         fileError.message());
+    return false;
+  }
+  bool written;
+  {
+    ::llvm::raw_fd_ostream file(fd, true);
+    file << cacheHeader << '\n';
+    for (auto it = this->entries.rbegin(); it != this->entries.rend(); ++it) {
+      file << it->first << ' ' << (it->second ? '1' : '0') << '\n';
+    }
+    file.close();
+    written = !file.has_error();
+    file.clear_error();
+  }
+  if (!written || ::llvm::sys::fs::rename(tempPath, this->filePath)) {
+    ::llvm::sys::fs::remove(tempPath);
+    ChimeraLogger::error("Couldn't write the validation cache " +
+                         this->filePath);
+    return false;
+  }
+  this->dirty = false;
+  return true;
+}
@@ -0,0 +1,160 @@
+//===- ValidationPool.cpp ---------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ValidationPool.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the class ValidationPool
+//===----------------------------------------------------------------------===//
+
+#include "Tooling/ValidationPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+chimera::ValidationPool::ValidationPool(unsigned workers,
+                                        SessionFactory factory,
+                                        ::std::size_t maxInFlight)
+    : factory(factory),
+      maxInFlight(::std::max<::std::size_t>(
+          1, maxInFlight != 0 ? maxInFlight : 4 * workers)),
+      stopping(false) {
+  for (unsigned i = 0; i < workers; ++i) {
+    this->threads.emplace_back(&ValidationPool::work_, this);
+  }
+}
+
+chimera::ValidationPool::~ValidationPool() {
+  this->drain();
+  {
+    ::std::lock_guard<::std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->jobAvailable.notify_all();
+  for (auto &t : this->threads) {
+    t.join();
+  }
+}
+
+void chimera::ValidationPool::enqueue_(JobPtr job,
+                                       ::std::vector<Pending> &mutants) {
+  {
+    ::std::lock_guard<::std::mutex> lock(this->mutex);
+    for (auto &m : mutants) {
+      m.job = job;
+      this->pending.push_back(::std::move(m));
+    }
+    // A job already done isn't queued, no worker has to check it
+    if (!job->done) {
+      this->queue.push_back(job);
+    }
+  }
+  mutants.clear();
+  this->jobAvailable.notify_one();
+  // Commit what is ready, blocking only if too many mutants are in flight
+  this->commit_(this->maxInFlight - 1);
+}
+
+void chimera::ValidationPool::submit(::std::string code,
+                                     ::std::vector<::std::string> extraArgs,
+                                     CommitCallback onCommit) {
+  CodePtr shared(new ::std::string(::std::move(code)));
+  ::std::vector<Pending> mutants;
+  mutants.push_back(Pending{nullptr, 0, shared, ::std::move(onCommit)});
+  JobPtr job(new Job{[shared, extraArgs](ValidationSession &session) {
+                       return ::std::vector<bool>{
+                           session.check(*shared, extraArgs)};
+                     },
+                     ::std::vector<bool>(), false});
+  this->enqueue_(job, mutants);
+}
+
+void chimera::ValidationPool::submitResolved(bool valid, ::std::string code,
+                                             CommitCallback onCommit) {
+  CodePtr shared(new ::std::string(::std::move(code)));
+  ::std::vector<Pending> mutants;
+  mutants.push_back(Pending{nullptr, 0, shared, ::std::move(onCommit)});
+  JobPtr job(new Job{nullptr, ::std::vector<bool>{valid}, true});
+  this->enqueue_(job, mutants);
+}
+
+chimera::ValidationPool::CodePtr
+chimera::ValidationPool::submitToGroup(::std::string code,
+                                       CommitCallback onCommit) {
+  CodePtr shared(new ::std::string(::std::move(code)));
+  this->group.push_back(
+      Pending{nullptr, this->group.size(), shared, ::std::move(onCommit)});
+  return shared;
+}
+
+void chimera::ValidationPool::closeGroup(GroupWork work) {
+  if (this->group.empty()) {
+    return;
+  }
+  JobPtr job(new Job{::std::move(work), ::std::vector<bool>(), false});
+  this->enqueue_(job, this->group);
+}
+
+void chimera::ValidationPool::drain() {
+  assert(this->group.empty() && "Draining with an open group");
+  this->commit_(0);
+}
+
+void chimera::ValidationPool::commit_(::std::size_t waitUntil) {
+  ::std::unique_lock<::std::mutex> lock(this->mutex);
+  while (!this->pending.empty()) {
+    if (!this->pending.front().job->done) {
+      if (this->pending.size() <= waitUntil) {
+        return;
+      }
+      JobPtr job = this->pending.front().job;
+      this->jobDone.wait(lock, [&job] { return job->done; });
+    }
+    Pending mutant = ::std::move(this->pending.front());
+    this->pending.pop_front();
+    // The callback can take its time, the workers go on meanwhile
+    lock.unlock();
+    mutant.onCommit(mutant.job->results[mutant.index], *mutant.code);
+    lock.lock();
+  }
+}
+
+void chimera::ValidationPool::work_() {
+  ::std::unique_ptr<ValidationSession> session = this->factory();
+  // The RUN/DONE pairs of the sessions would interleave with each other and
+  // with the per-mutant lines of the matching thread
+  session->setQuiet(true);
+  ::std::unique_lock<::std::mutex> lock(this->mutex);
+  while (true) {
+    this->jobAvailable.wait(
+        lock, [this] { return this->stopping || !this->queue.empty(); });
+    if (this->queue.empty()) {
+      // Stopping with nothing left
+      return;
+    }
+    JobPtr job = this->queue.front();
+    this->queue.pop_front();
+    lock.unlock();
+    ::std::vector<bool> results = job->work(*session);
+    lock.lock();
+    job->results = ::std::move(results);
+    job->done = true;
+    this->jobDone.notify_all();
+  }
+}
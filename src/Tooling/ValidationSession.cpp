@@ -0,0 +1,291 @@
+//===- ValidationSession.cpp ------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Clang-Chimera.
+//
+//  Clang-Chimera is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Clang-Chimera is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Clang-Chimera. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file ValidationSession.cpp
+/// \author Federico Iannucci
+/// \brief This file implements the class ValidationSession
+//===----------------------------------------------------------------------===//
+
+#include "Log.h"
+#include "Tooling/FrontendActions.h"
+#include "Tooling/ValidationSession.h"
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Frontend/Utils.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <algorithm>
+
+using namespace clang;
+using namespace chimera::log;
+
+namespace {
+/// @brief Diagnostic consumer that records the main file offsets of the errors
+class ErrorOffsetRecorder : public DiagnosticConsumer {
+ public:
+  ErrorOffsetRecorder() : unattributed(false) {}
+
+  void HandleDiagnostic(DiagnosticsEngine::Level level,
+                        const Diagnostic &info) override {
+    DiagnosticConsumer::HandleDiagnostic(level, info);
+    if (level < DiagnosticsEngine::Error) {
+      return;
+    }
+    // A fatal error stops the parse, the code after it isn't checked
+    if (level == DiagnosticsEngine::Fatal || !info.getLocation().isValid() ||
+        !info.hasSourceManager()) {
+      this->unattributed = true;
+      return;
+    }
+    const SourceManager &sm = info.getSourceManager();
+    // Macro expansions are attributed to where they are expanded
+    SourceLocation loc = sm.getFileLoc(info.getLocation());
+    if (!sm.isInMainFile(loc)) {
+      this->unattributed = true;
+      return;
+    }
+    this->offsets.push_back(sm.getFileOffset(loc));
+  }
+
+  ::std::vector<unsigned> offsets; ///< Offsets of the errors
+  bool unattributed;               ///< If an error can't be attributed
+};
+} // end anonymous namespace
+
+/// @brief If the last parse of the unit produced errors
+static bool hasErrors(const ASTUnit &unit) {
+  for (ASTUnit::stored_diag_iterator d = unit.stored_diag_begin(),
+                                     e = unit.stored_diag_end();
+       d != e; ++d) {
+    if (d->getLevel() >= DiagnosticsEngine::Error) {
+      return true;
+    }
+  }
+  return false;
+}
+
+chimera::ValidationSession::ValidationSession(
+    const ::clang::tooling::CompileCommand &command,
+    const ::std::string &targetPath, bool usePreamble)
+    : command(command), targetPath(targetPath), usePreamble(usePreamble),
+      pchOperations(::std::make_shared<PCHContainerOperations>()),
+      fileManager(nullptr), invocations(), preambleUnit(nullptr),
+      preambleFailed(false), quiet(false), cache(nullptr) {}
+
+::clang::CompilerInvocation *chimera::ValidationSession::getInvocation_(
+    const ::std::vector<::std::string> &extraArgs) {
+  auto it = this->invocations.find(extraArgs);
+  if (it != this->invocations.end()) {
+    // A null entry records a command that can't be parsed
+    return it->second.get();
+  }
+
+  if (!this->quiet) {
+    ChimeraLogger::verboseAndIncr("[ RUN  ] Parsing the compile command");
+  }
+  ::std::vector<const char *> args;
+  for (const auto &arg : this->command.CommandLine) {
+    args.push_back(arg.c_str());
+  }
+  for (const auto &arg : extraArgs) {
+    args.push_back(arg.c_str());
+  }
+  IntrusiveRefCntPtr<DiagnosticsEngine> diags =
+      CompilerInstance::createDiagnostics(new DiagnosticOptions(),
+                                          new IgnoringDiagConsumer());
+  InvocationPtr invocation(createInvocationFromCommandLine(args, diags));
+  if (invocation) {
+    // Resolve relative paths as the compile command would do, without
+    // changing the working directory of the process
+    invocation->getFileSystemOpts().WorkingDir = this->command.Directory;
+    if (!this->fileManager) {
+      this->fileManager = new FileManager(invocation->getFileSystemOpts());
+    }
+    if (!this->quiet) {
+      ChimeraLogger::verbosePreDecr("[ DONE ] Parsing the compile command");
+    }
+  } else if (!this->quiet) {
+    ChimeraLogger::verbosePreDecr("[ FAIL ] Parsing the compile command");
+  }
+  this->invocations[extraArgs] = invocation;
+  return invocation.get();
+}
+
+bool chimera::ValidationSession::checkOnInvocation_(
+    const ::clang::CompilerInvocation &invocation, ::llvm::StringRef code) {
+  CompilerInstance compiler(this->pchOperations);
+  compiler.setInvocation(new CompilerInvocation(invocation));
+  // Only the error count is needed, the diagnostics are dropped
+  IgnoringDiagConsumer diagConsumer;
+  compiler.createDiagnostics(&diagConsumer, /*ShouldOwnClient=*/false);
+  if (!compiler.hasDiagnostics()) {
+    return false;
+  }
+  compiler.setFileManager(this->fileManager.get());
+  // The preprocessor takes the ownership of the remapped buffer
+  compiler.getPreprocessorOpts().addRemappedFile(
+      this->targetPath,
+      ::llvm::MemoryBuffer::getMemBufferCopy(code, this->targetPath).release());
+
+  SyntaxOnlyAction action;
+  if (!compiler.ExecuteAction(action)) {
+    return false;
+  }
+  return !compiler.getDiagnostics().hasErrorOccurred();
+}
+
+bool chimera::ValidationSession::checkAttributing(
+    ::llvm::StringRef code, const ::std::vector<Range> &ranges,
+    ::std::vector<bool> &implicated,
+    const ::std::vector<::std::string> &extraArgs) {
+  implicated.assign(ranges.size(), false);
+  CompilerInvocation *invocation = this->getInvocation_(extraArgs);
+  if (invocation == nullptr) {
+    return false;
+  }
+  CompilerInstance compiler(this->pchOperations);
+  compiler.setInvocation(new CompilerInvocation(*invocation));
+  // All the errors are needed, not only the first ones
+  compiler.getDiagnosticOpts().ErrorLimit = 0;
+  ErrorOffsetRecorder recorder;
+  compiler.createDiagnostics(&recorder, /*ShouldOwnClient=*/false);
+  if (!compiler.hasDiagnostics()) {
+    return false;
+  }
+  compiler.setFileManager(this->fileManager.get());
+  compiler.getPreprocessorOpts().addRemappedFile(
+      this->targetPath,
+      ::llvm::MemoryBuffer::getMemBufferCopy(code, this->targetPath).release());
+
+  // The action fails on any error, the recorder tells which ones
+  SyntaxOnlyAction action;
+  compiler.ExecuteAction(action);
+  if (recorder.unattributed) {
+    return false;
+  }
+  for (unsigned offset : recorder.offsets) {
+    // The first range ending after the error
+    auto it = ::std::upper_bound(
+        ranges.begin(), ranges.end(), offset,
+        [](unsigned o, const Range &r) { return o < r.second; });
+    if (it == ranges.end() || offset < it->first) {
+      // Outside the ranges, the cause could be anywhere
+      return false;
+    }
+    ::std::size_t i = it - ranges.begin();
+    implicated[i] = true;
+    if (i > 0) {
+      implicated[i - 1] = true;
+    }
+  }
+  return true;
+}
+
+bool chimera::ValidationSession::lookupCache(
+    ::llvm::StringRef code, const ::std::vector<::std::string> &extraArgs,
+    bool &valid) {
+  return this->cache != nullptr &&
+         this->cache->lookup(
+             ValidationCache::computeKey(code, this->command, extraArgs),
+             valid);
+}
+
+void chimera::ValidationSession::storeCache(
+    ::llvm::StringRef code, const ::std::vector<::std::string> &extraArgs,
+    bool valid) {
+  if (this->cache != nullptr) {
+    this->cache->insert(
+        ValidationCache::computeKey(code, this->command, extraArgs), valid);
+  }
+}
+
+bool chimera::ValidationSession::checkOnPreamble_(::llvm::StringRef code) {
+  if (!this->preambleUnit) {
+    if (!this->quiet) {
+      ChimeraLogger::verboseAndIncr(
+          "[ RUN  ] Precompiling the target preamble");
+    }
+    IntrusiveRefCntPtr<DiagnosticsEngine> diags =
+        CompilerInstance::createDiagnostics(new DiagnosticOptions(),
+                                            new IgnoringDiagConsumer());
+    // The first parse precompiles the preamble, the unit owns its invocation
+    this->preambleUnit = ASTUnit::LoadFromCompilerInvocation(
+        new CompilerInvocation(*this->getInvocation_({})),
+        this->pchOperations, diags, this->fileManager.get(),
+        /*OnlyLocalDecls=*/false, /*CaptureDiagnostics=*/true,
+        /*PrecompilePreambleAfterNParses=*/1);
+    if (!this->preambleUnit) {
+      this->preambleFailed = true;
+      if (!this->quiet) {
+        ChimeraLogger::verbosePreDecr(
+            "[ FAIL ] Precompiling the target preamble");
+      }
+      return this->checkOnInvocation_(*this->getInvocation_({}), code);
+    }
+    if (!this->quiet) {
+      ChimeraLogger::verbosePreDecr(
+          "[ DONE ] Precompiling the target preamble");
+    }
+  }
+  // The unit takes the ownership of the remapped buffer
+  ASTUnit::RemappedFile mutant(
+      this->targetPath,
+      ::llvm::MemoryBuffer::getMemBufferCopy(code, this->targetPath)
+          .release());
+  if (this->preambleUnit->Reparse(this->pchOperations, mutant)) {
+    // Reparse failed without diagnostics
+    return false;
+  }
+  return !hasErrors(*this->preambleUnit);
+}
+
+bool chimera::ValidationSession::check(
+    ::llvm::StringRef code, const ::std::vector<::std::string> &extraArgs) {
+  if (this->cache == nullptr) {
+    return this->checkUncached_(code, extraArgs);
+  }
+  ValidationCache::KeyType key =
+      ValidationCache::computeKey(code, this->command, extraArgs);
+  bool valid;
+  if (!this->cache->lookup(key, valid)) {
+    valid = this->checkUncached_(code, extraArgs);
+    this->cache->insert(key, valid);
+  }
+  return valid;
+}
+
+bool chimera::ValidationSession::checkUncached_(
+    ::llvm::StringRef code, const ::std::vector<::std::string> &extraArgs) {
+  CompilerInvocation *invocation = this->getInvocation_(extraArgs);
+  if (invocation == nullptr) {
+    // The command isn't understood by the frontend, let the driver try it
+    ::clang::tooling::CompileCommand c = this->command;
+    c.CommandLine.insert(c.CommandLine.end(), extraArgs.begin(),
+                         extraArgs.end());
+    return ::chimera::checkSyntaxActionOnCode(c, this->targetPath, code) == 0;
+  }
+  // The preamble is precompiled for the plain compile command only
+  if (this->usePreamble && extraArgs.empty() && !this->preambleFailed) {
+    return this->checkOnPreamble_(code);
+  }
+  return this->checkOnInvocation_(*invocation, code);
+}
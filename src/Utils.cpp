@@ -91,3 +91,22 @@ bool chimera::fs::createDirectories(const llvm::Twine& path,
   sys::fs::create_directories(path, ignoreExisting);
   return sys::fs::is_directory(path);
 }
+
+void chimera::fs::deleteDirectory(const llvm::Twine& path) {
+  std::string directory = path.str();
+  // The entries are collected first, the iteration doesn't survive removals
+  std::vector<std::string> entries;
+  std::error_code error;
+  for (sys::fs::directory_iterator it(directory, error), end;
+       !error && it != end; it.increment(error)) {
+    entries.push_back(it->path());
+  }
+  for (const std::string &entry : entries) {
+    if (sys::fs::is_directory(entry)) {
+      deleteDirectory(entry);
+    } else {
+      sys::fs::remove(entry);
+    }
+  }
+  sys::fs::remove(directory);
+}
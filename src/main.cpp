@@ -28,16 +28,18 @@
 
 // For testing purpose
 #include "Testing/MutatorsTesting.h"
+#include "Testing/OutputTesting.h"
+#include "Testing/ValidationTesting.h"
 
 int main(int argc, const char **argv) {
   // Create a Chimera Tool
   ::chimera::ChimeraTool chimeraTool;
   
-  chimeraTool.registerMutationOperator(::chimera::flapmutator::getFLAPOperator());
-  chimeraTool.registerMutationOperator(::chimera::vpamutator::getVPAOperator());
-  chimeraTool.registerMutationOperator(::chimera::vpa_nmutator::getVPANOperator());
-  chimeraTool.registerMutationOperator(::chimera::perforation::getPerforationFirstOperator());
-  chimeraTool.registerMutationOperator(::chimera::perforation::getPerforationSecondOperator());
+  chimeraTool.registerMutationOperator(&::chimera::flapmutator::getFLAPOperator);
+  chimeraTool.registerMutationOperator(&::chimera::vpamutator::getVPAOperator);
+  chimeraTool.registerMutationOperator(&::chimera::vpa_nmutator::getVPANOperator);
+  chimeraTool.registerMutationOperator(&::chimera::perforation::getPerforationFirstOperator);
+  chimeraTool.registerMutationOperator(&::chimera::perforation::getPerforationSecondOperator);
 
   return chimeraTool.run(argc, argv);
 }
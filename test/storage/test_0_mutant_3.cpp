@@ -0,0 +1,13 @@
+int max(int a, int b) {
+  if (a > b) {
+    return a;
+  }
+  return b;
+}
+
+int clamp(int v, int lo, int hi) {
+  if (v > hi) {
+    return hi;
+  }
+  return v;
+}